@@ -0,0 +1,44 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+
+namespace benchmark {
+
+/// Wall clock time of a function call (in seconds).
+template <typename Fn>
+double measure(Fn&& fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// SPSC ring buffer throughput, legacy versus current queue.
+void runRingBuffer();
+
+/// Organ rendering throughput at the compiled sub-frame length.
+void runSubFrame();
+
+/// Reverb convolution, two real FFTs versus the stereo-packed complex FFT.
+void runStereoPacking();
+
+} // namespace benchmark
@@ -0,0 +1,74 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+struct Entry
+{
+    const char* name;
+    std::function<void()> run;
+};
+
+const Entry benchmarks[] = {
+    { "ringbuffer", benchmark::runRingBuffer },
+    { "subframe", benchmark::runSubFrame },
+    { "stereopacking", benchmark::runStereoPacking },
+};
+
+} // namespace
+
+/**
+ * Run the benchmarks given by name on the command line, or all of them.
+ * Build with optimizations, the results of a debug build are meaningless.
+ */
+int main(int argc, char* argv[])
+{
+    int numRun = 0;
+
+    for (const auto& entry : benchmarks) {
+        bool selected = argc < 2;
+
+        for (int i = 1; i < argc; ++i)
+            selected |= std::strcmp(argv[i], entry.name) == 0;
+
+        if (selected) {
+            std::printf("== %s\n", entry.name);
+            entry.run();
+            ++numRun;
+        }
+    }
+
+    if (numRun == 0) {
+        std::printf("Available benchmarks:");
+
+        for (const auto& entry : benchmarks)
+            std::printf(" %s", entry.name);
+
+        std::printf("\n");
+        return 1;
+    }
+
+    return 0;
+}
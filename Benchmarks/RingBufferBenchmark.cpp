@@ -0,0 +1,204 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "Benchmark.h"
+#include "aeolus/ringbuffer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace benchmark {
+
+namespace {
+
+/// The ring buffer as it was before the padded version: adjacent
+/// sequentially consistent indices wrapped with a modulo.
+template <typename T, size_t Size>
+class LegacyRingBuffer final
+{
+public:
+
+    bool send (const T& obj) noexcept
+    {
+        size_t nextIdx = writeIdx + 1 < Size ? writeIdx + 1 : 0;
+
+        if (nextIdx != readIdx)
+        {
+            data[writeIdx] = obj;
+            writeIdx = nextIdx;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool receive (T& obj) noexcept
+    {
+        size_t nextIdx = readIdx + 1 < Size ? readIdx + 1 : 0;
+
+        if (readIdx != writeIdx)
+        {
+            obj = std::move (data[readIdx]);
+            readIdx = nextIdx;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+
+    std::atomic<size_t> readIdx{0};
+    std::atomic<size_t> writeIdx{0};
+    T data[Size]{};
+};
+
+/// Same size as the engine note events.
+struct Item
+{
+    uint64_t seq;
+    uint64_t payload;
+};
+
+constexpr size_t queueSize = 1024;
+constexpr uint64_t numItems = 20'000'000;
+constexpr size_t batchSize = 32;
+
+/// Returns whether all the items came in order.
+/// Both sides yield on a full or empty queue, so that this runs on a single core as well.
+template <typename Queue, typename Producer, typename Consumer>
+bool transfer(Queue& queue, Producer produce, Consumer consume)
+{
+    std::thread producer([&] { produce(queue); });
+    const bool ok = consume(queue);
+    producer.join();
+    return ok;
+}
+
+template <typename Queue>
+void produceSingle(Queue& queue)
+{
+    for (uint64_t i = 0; i < numItems; ) {
+        if (queue.send({ i, i }))
+            ++i;
+        else
+            std::this_thread::yield();
+    }
+}
+
+template <typename Queue>
+bool consumeSingle(Queue& queue)
+{
+    Item item{};
+
+    for (uint64_t i = 0; i < numItems; ) {
+        if (queue.receive(item)) {
+            if (item.seq != i)
+                return false;
+
+            ++i;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+void produceBatches(aeolus::RingBuffer<Item, queueSize>& queue)
+{
+    Item items[batchSize];
+
+    for (uint64_t i = 0; i < numItems; ) {
+        const size_t n = (size_t)std::min<uint64_t>(batchSize, numItems - i);
+
+        for (size_t k = 0; k < n; ++k)
+            items[k] = { i + k, i + k };
+
+        // Whatever did not fit is sent again.
+        const size_t sent = queue.sendN(items, n);
+        i += sent;
+
+        if (sent == 0)
+            std::this_thread::yield();
+    }
+}
+
+bool consumeBatches(aeolus::RingBuffer<Item, queueSize>& queue)
+{
+    Item items[batchSize];
+
+    for (uint64_t i = 0; i < numItems; ) {
+        const size_t n = queue.receiveN(items, batchSize);
+
+        for (size_t k = 0; k < n; ++k) {
+            if (items[k].seq != i + k)
+                return false;
+        }
+
+        i += n;
+
+        if (n == 0)
+            std::this_thread::yield();
+    }
+
+    return true;
+}
+
+void report(const char* name, double seconds, bool ok)
+{
+    std::printf("%-28s %8.1f M items/s  %6.2f ns/item%s\n",
+                name, numItems / seconds * 1e-6, seconds * 1e9 / numItems, ok ? "" : "  ORDER ERROR");
+}
+
+} // namespace
+
+void runRingBuffer()
+{
+    std::printf("%llu items of %zu bytes through a %zu slots queue, producer and consumer threads\n",
+                (unsigned long long)numItems, sizeof(Item), queueSize);
+
+    {
+        auto queue = std::make_unique<LegacyRingBuffer<Item, queueSize>>();
+        bool ok = false;
+        const double t = measure([&] { ok = transfer(*queue, produceSingle<LegacyRingBuffer<Item, queueSize>>,
+                                                             consumeSingle<LegacyRingBuffer<Item, queueSize>>); });
+        report("legacy send/receive", t, ok);
+    }
+
+    {
+        auto queue = std::make_unique<aeolus::RingBuffer<Item, queueSize>>();
+        bool ok = false;
+        const double t = measure([&] { ok = transfer(*queue, produceSingle<aeolus::RingBuffer<Item, queueSize>>,
+                                                             consumeSingle<aeolus::RingBuffer<Item, queueSize>>); });
+        report("padded send/receive", t, ok);
+    }
+
+    {
+        auto queue = std::make_unique<aeolus::RingBuffer<Item, queueSize>>();
+        bool ok = false;
+        const double t = measure([&] { ok = transfer(*queue, produceBatches, consumeBatches); });
+        report("padded sendN/receiveN (32)", t, ok);
+    }
+}
+
+} // namespace benchmark
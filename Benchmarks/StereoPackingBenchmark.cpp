@@ -0,0 +1,157 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "Benchmark.h"
+#include "aeolus/dsp/convolver.h"
+#include "aeolus/dsp/fft.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace benchmark {
+
+namespace {
+
+constexpr unsigned fftLength = 2 * aeolus::dsp::Convolver::BlockSize;
+constexpr int numTransforms = 2000;
+
+constexpr int irLength = 200'000;
+constexpr int numSamples = 400'000;
+constexpr int blockSize = 64;
+
+/// Forward and inverse transforms of both channels, as done for each partitioned convolution block.
+void runTransforms()
+{
+    using Real = aeolus::dsp::GRFFT<fftLength>;
+    using Stereo = aeolus::dsp::GStereoFFT<fftLength>;
+
+    std::vector<float> left(fftLength);
+    std::vector<float> right(fftLength);
+    std::vector<float> scratch(Stereo::ScratchSize);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    const auto fill = [&] {
+        for (unsigned i = 0; i < fftLength; ++i) {
+            left[i] = dist(rng);
+            right[i] = dist(rng);
+        }
+    };
+
+    // The data is scaled by the inverse transforms, which does not matter for timing.
+    fill();
+    const double real = measure([&] {
+        for (int i = 0; i < numTransforms; ++i) {
+            Real::fft(left.data());
+            Real::fft(right.data());
+            Real::ifft(left.data());
+            Real::ifft(right.data());
+            left[0] = right[0] = 1.0f / fftLength;
+        }
+    });
+
+    fill();
+    const double stereo = measure([&] {
+        for (int i = 0; i < numTransforms; ++i) {
+            Stereo::fft(left.data(), right.data(), scratch.data());
+            Stereo::ifft(left.data(), right.data(), scratch.data());
+            left[0] = right[0] = 1.0f / fftLength;
+        }
+    });
+
+    std::printf("%u-point forward + inverse, 2 channels, %d times\n", fftLength, numTransforms);
+    std::printf("  %-16s %8.1f ms\n", "two real FFTs", 1e3 * real);
+    std::printf("  %-16s %8.1f ms\n", "stereo-packed", 1e3 * stereo);
+}
+
+/// Whole reverb, offline so that the background stages run inline and are timed as well.
+void runReverb()
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    juce::AudioBuffer<float> ir(2, irLength);
+
+    for (int ch = 0; ch < 2; ++ch) {
+        float* data = ir.getWritePointer(ch);
+
+        for (int i = 0; i < irLength; ++i)
+            data[i] = dist(rng) * std::exp(-float(i) / 40000.0f);
+    }
+
+    std::vector<float> inL(numSamples);
+    std::vector<float> inR(numSamples);
+
+    for (int i = 0; i < numSamples; ++i) {
+        inL[i] = dist(rng);
+        inR[i] = 0.5f * dist(rng);
+    }
+
+    std::vector<float> outL[2];
+    std::vector<float> outR[2];
+    double seconds[2];
+
+    for (int mode = 0; mode < 2; ++mode) {
+        aeolus::dsp::Convolver convolver;
+        convolver.setLength(irLength);
+        convolver.prepareToPlay(aeolus::SAMPLE_RATE_F, blockSize);
+        convolver.setNonRealtime(true);
+        convolver.setStereoPacking(mode == 1);
+        convolver.setIR(ir);
+        convolver.setDryWet(0.0f, 1.0f, true);
+
+        outL[mode].resize(numSamples);
+        outR[mode].resize(numSamples);
+
+        seconds[mode] = measure([&] {
+            for (int i = 0; i < numSamples; i += blockSize) {
+                convolver.process(&inL[(size_t) i], &inR[(size_t) i],
+                                  &outL[mode][(size_t) i], &outR[mode][(size_t) i], (size_t) blockSize);
+            }
+        });
+    }
+
+    double err = 0.0;
+    double ref = 0.0;
+
+    for (int i = 0; i < numSamples; ++i) {
+        const double dl = outL[1][(size_t) i] - outL[0][(size_t) i];
+        const double dr = outR[1][(size_t) i] - outR[0][(size_t) i];
+        err += dl * dl + dr * dr;
+        ref += outL[0][(size_t) i] * outL[0][(size_t) i] + outR[0][(size_t) i] * outR[0][(size_t) i];
+    }
+
+    std::printf("Reverb, %d samples IR over %d samples in blocks of %d\n", irLength, numSamples, blockSize);
+    std::printf("  %-16s %8.1f ms\n", "two real FFTs", 1e3 * seconds[0]);
+    std::printf("  %-16s %8.1f ms  (relative difference %.1e)\n", "stereo-packed", 1e3 * seconds[1],
+                ref > 0.0 ? std::sqrt(err / ref) : 0.0);
+}
+
+} // namespace
+
+void runStereoPacking()
+{
+    runTransforms();
+    runReverb();
+}
+
+} // namespace benchmark
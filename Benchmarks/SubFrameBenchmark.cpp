@@ -0,0 +1,353 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "Benchmark.h"
+
+#include "aeolus/globals.h"
+#include "aeolus/audioparam.h"
+#include "aeolus/simd.h"
+#include "aeolus/dsp/chiff.h"
+#include "aeolus/dsp/delay.h"
+#include "aeolus/dsp/filter.h"
+#include "aeolus/dsp/spatial.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace aeolus;
+
+namespace {
+
+constexpr int NumDivisions = 4;
+constexpr int NumVoicesPerDivision = 24;
+constexpr int VoiceBatchSize = dsp::BiquadBank::NumLanes;
+constexpr int NumSeconds = 20;
+
+/**
+ * Stand-in for a pipe wavetable: a looped period read with linear interpolation.
+ * The actual pipes are generated from the organ model, which needs the engine.
+ */
+class Pipe
+{
+public:
+
+    Pipe(float freq)
+        : _table(1024)
+        , _pos{0.0f}
+        , _inc{freq * float(_table.size()) / SAMPLE_RATE_F}
+    {
+        for (size_t i = 0; i < _table.size(); ++i) {
+            const float phase = juce::MathConstants<float>::twoPi * float(i) / float(_table.size());
+            _table[i] = 0.5f * std::sin(phase) + 0.25f * std::sin(2.0f * phase) + 0.125f * std::sin(3.0f * phase);
+        }
+    }
+
+    void play(float* out)
+    {
+        const float size = float(_table.size());
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
+            const int k = int(_pos);
+            const float frac = _pos - float(k);
+            const float a = _table[(size_t)k];
+            const float b = _table[(size_t)(k + 1) % _table.size()];
+            out[i] = a + frac * (b - a);
+
+            _pos += _inc;
+
+            if (_pos >= size)
+                _pos -= size;
+        }
+    }
+
+private:
+
+    std::vector<float> _table;
+    float _pos;
+    float _inc;
+};
+
+/// Voice rendering like aeolus::Voice, minus the pipe envelopes.
+class Voice
+{
+public:
+
+    explicit Voice(int note)
+        : _pipe{440.0f * std::pow(2.0f, float(note - 69) / 12.0f)}
+        , _delayLine{SAMPLE_RATE}
+        , _delay{0}
+        , _chiff{}
+        , _spatialSource{}
+    {
+        const float freq = 440.0f * std::pow(2.0f, float(note - 69) / 12.0f);
+        const float dt = 1.0f / freq;
+
+        _delay = (int) juce::jmin((float)_delayLine.size(), 0.5f * dt * SAMPLE_RATE_F);
+
+        _chiff.setSampleRate(SAMPLE_RATE_F);
+        _chiff.setAttack(5.0f * dt);
+        _chiff.setDecay(100.0f * dt);
+        _chiff.setSustain(0.01f);
+        _chiff.setRelease(100.0f * dt);
+        _chiff.setGain(0.02f);
+        _chiff.setFrequency(freq);
+        _chiff.trigger();
+
+        const float k = note % 2 != 0 ? 1.0f : -1.0f;
+        _spatialSource.setSampleRate(SAMPLE_RATE_F);
+        _spatialSource.setSourcePosition(0.15f * k * (float)std::abs(note - 65), 5.0f);
+        _spatialSource.recalculate();
+    }
+
+    void processUnfiltered(float* outL, float* outR, int stride)
+    {
+        _pipe.play(_buffer);
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
+            _delayLine.write(_buffer[i]);
+            _buffer[i] = _delayLine.readNearest(_delay);
+        }
+
+        _chiff.process(_buffer, SUB_FRAME_LENGTH);
+        _spatialSource.processUnfiltered(_buffer, outL, outR, SUB_FRAME_LENGTH, stride);
+    }
+
+    dsp::SpatialSource& getSpatialSource() noexcept { return _spatialSource; }
+
+private:
+
+    Pipe _pipe;
+    dsp::DelayLine _delayLine;
+    int _delay;
+    dsp::Chiff _chiff;
+    dsp::SpatialSource _spatialSource;
+    float _buffer[SUB_FRAME_LENGTH];
+};
+
+/// Division processing like aeolus::Division, with the tremulant and the swell.
+class Division
+{
+public:
+
+    explicit Division(int firstNote)
+        : _voices{}
+        , _gain{1.0f, 0.0f, 1.0f, 0.01f}
+        , _tremulantDelay(TREMULANT_DELAY_LENGTH)
+        , _swellFilterSpec{}
+        , _swellFilterStateL{}
+        , _swellFilterStateR{}
+    {
+        for (int i = 0; i < NumVoicesPerDivision; ++i)
+            _voices.push_back(std::make_unique<Voice>(firstNote + 2 * i));
+
+        _swellFilterSpec.type = dsp::BiquadFilter::LowPass;
+        _swellFilterSpec.sampleRate = SAMPLE_RATE_F;
+        _swellFilterSpec.dbGain = 0.0f;
+        _swellFilterSpec.q = 0.7071f;
+        _swellFilterSpec.freq = 8000.0f;
+        dsp::BiquadFilter::updateSpec(_swellFilterSpec);
+        dsp::BiquadFilter::resetState(_swellFilterSpec, _swellFilterStateL);
+        dsp::BiquadFilter::resetState(_swellFilterSpec, _swellFilterStateR);
+    }
+
+    void process(float* outL, float* outR)
+    {
+        for (size_t first = 0; first < _voices.size(); first += VoiceBatchSize)
+            processVoiceBatch(first, juce::jmin((int)(_voices.size() - first), VoiceBatchSize), outL, outR);
+    }
+
+    void modulate(float* outL, float* outR, const float* tremulant, float gain)
+    {
+        constexpr float lvl = TREMULANT_TARGET_LEVEL;
+
+        _gain.setValue(gain);
+
+        float g[SUB_FRAME_LENGTH];
+        _gain.nextValues(g, SUB_FRAME_LENGTH);
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i)
+            g[i] *= 1.0f + tremulant[i] * lvl;
+
+        const float freqModCenter = TREMULANT_DELAY_LENGTH * 0.5f;
+        const float freqModAmp = TREMULANT_DELAY_LENGTH * 0.5f * TREMULANT_DELAY_MODULATION_LEVEL;
+        float delays[SUB_FRAME_LENGTH];
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i)
+            delays[i] = freqModCenter + freqModAmp * (0.5f - tremulant[i] * lvl);
+
+        _tremulantDelay.process(outL, outR, delays, SUB_FRAME_LENGTH);
+
+        simd::mul(outL, g, SUB_FRAME_LENGTH);
+        simd::mul(outR, g, SUB_FRAME_LENGTH);
+
+        dsp::BiquadFilter::processStereo(_swellFilterSpec, _swellFilterStateL, _swellFilterStateR, outL, outR, SUB_FRAME_LENGTH);
+    }
+
+private:
+
+    void processVoiceBatch(size_t first, int numVoices, float* outL, float* outR)
+    {
+        constexpr int numLanes = dsp::BiquadBank::NumLanes;
+        float left[SUB_FRAME_LENGTH * numLanes];
+        float right[SUB_FRAME_LENGTH * numLanes];
+
+        dsp::BiquadBank bankL;
+        dsp::BiquadBank bankR;
+
+        if (numVoices < numLanes) {
+            ::memset(left, 0, sizeof(left));
+            ::memset(right, 0, sizeof(right));
+        }
+
+        for (int k = 0; k < numVoices; ++k) {
+            auto& voice = *_voices[first + (size_t)k];
+            auto& spatial = voice.getSpatialSource();
+            voice.processUnfiltered(left + k, right + k, numLanes);
+
+            bankL.load(k, spatial.getFilterSpec(0), spatial.getFilterState(0));
+            bankR.load(k, spatial.getFilterSpec(1), spatial.getFilterState(1));
+        }
+
+        bankL.process(left, SUB_FRAME_LENGTH);
+        bankR.process(right, SUB_FRAME_LENGTH);
+
+        for (int k = 0; k < numVoices; ++k) {
+            auto& spatial = _voices[first + (size_t)k]->getSpatialSource();
+            bankL.store(k, spatial.getFilterState(0));
+            bankR.store(k, spatial.getFilterState(1));
+        }
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
+            const float* frameL = left + i * numLanes;
+            const float* frameR = right + i * numLanes;
+            float l = outL[i];
+            float r = outR[i];
+
+            for (int k = 0; k < numVoices; ++k) {
+                l += frameL[k];
+                r += frameR[k];
+            }
+
+            outL[i] = l;
+            outR[i] = r;
+        }
+    }
+
+    std::vector<std::unique_ptr<Voice>> _voices;
+    AudioParameter _gain;
+    dsp::ModulatedDelay _tremulantDelay;
+    dsp::BiquadFilter::Spec _swellFilterSpec;
+    dsp::BiquadFilter::State _swellFilterStateL;
+    dsp::BiquadFilter::State _swellFilterStateR;
+};
+
+/// Sub-frame processing like Engine::processSubFrame().
+class Organ
+{
+public:
+
+    Organ()
+        : _divisions{}
+        , _tremulantPhase{0.0f}
+        , _tremulantPhaseIncrement{juce::MathConstants<float>::twoPi * TREMULANT_FREQUENCY / SAMPLE_RATE_F}
+    {
+        for (int i = 0; i < NumDivisions; ++i)
+            _divisions.push_back(std::make_unique<Division>(36 + 6 * i));
+    }
+
+    float processSubFrame(int subFrame)
+    {
+        generateTremulant();
+
+        ::memset(_outL, 0, sizeof(_outL));
+        ::memset(_outR, 0, sizeof(_outR));
+
+        // Swell pedal moving every now and then.
+        const float gain = (subFrame * SUB_FRAME_LENGTH / SAMPLE_RATE) % 2 == 0 ? 1.0f : 0.5f;
+
+        for (auto& division : _divisions) {
+            float divisionL[SUB_FRAME_LENGTH] = {};
+            float divisionR[SUB_FRAME_LENGTH] = {};
+
+            division->process(divisionL, divisionR);
+            division->modulate(divisionL, divisionR, _tremulant, gain);
+
+            simd::add(_outL, divisionL, SUB_FRAME_LENGTH);
+            simd::add(_outR, divisionR, SUB_FRAME_LENGTH);
+        }
+
+        return _outL[0] + _outR[SUB_FRAME_LENGTH - 1];
+    }
+
+private:
+
+    void generateTremulant()
+    {
+        const float cw = std::cos(_tremulantPhaseIncrement);
+        const float sw = std::sin(_tremulantPhaseIncrement);
+        float s = std::sin(_tremulantPhase);
+        float c = std::cos(_tremulantPhase);
+
+        for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
+            _tremulant[i] = s * TREMULANT_LEVEL;
+
+            const float sn = s * cw + c * sw;
+            c = c * cw - s * sw;
+            s = sn;
+        }
+
+        _tremulantPhase = std::fmod(_tremulantPhase + SUB_FRAME_LENGTH * _tremulantPhaseIncrement,
+                                    juce::MathConstants<float>::twoPi);
+    }
+
+    std::vector<std::unique_ptr<Division>> _divisions;
+    float _tremulantPhase;
+    float _tremulantPhaseIncrement;
+    float _tremulant[SUB_FRAME_LENGTH];
+    float _outL[SUB_FRAME_LENGTH];
+    float _outR[SUB_FRAME_LENGTH];
+};
+
+} // namespace
+
+namespace benchmark {
+
+void runSubFrame()
+{
+    Organ organ;
+
+    const int numSubFrames = NumSeconds * SAMPLE_RATE / SUB_FRAME_LENGTH;
+    float checksum = 0.0f;
+
+    const double seconds = measure([&] {
+        for (int i = 0; i < numSubFrames; ++i)
+            checksum += organ.processSubFrame(i);
+    });
+
+    const double numSamples = double(numSubFrames) * SUB_FRAME_LENGTH;
+
+    std::printf("sub-frame %3d samples, %d voices: %6.2f ns/sample, %6.1fx real time (checksum %g)\n",
+                SUB_FRAME_LENGTH, NumDivisions * NumVoicesPerDivision,
+                1e9 * seconds / numSamples, numSamples / SAMPLE_RATE_F / seconds, (double)checksum);
+}
+
+} // namespace benchmark
@@ -180,7 +180,7 @@ AeolusAudioProcessorEditor::AeolusAudioProcessorEditor (AeolusAudioProcessor& p)
 
     _settingsButton.onClick = [this] {
         auto content = std::make_unique<ui::SettingsComponent>();
-        content->setSize(240, 120);
+        content->setSize(280, 484);
         auto* contentPtr = content.get();
 
         auto& box = CallOutBox::launchAsynchronously(std::move(content), _settingsButton.getBounds(), this);
@@ -190,10 +190,56 @@ AeolusAudioProcessorEditor::AeolusAudioProcessorEditor (AeolusAudioProcessor& p)
             const float uiScalingFactor = contentPtr->getUIScalingFactor();
             const bool uiScalingFactorChanged = (g->getUIScalingFactor() != uiScalingFactor);
 
-            if (uiScalingFactorChanged) {
+            if (uiScalingFactorChanged)
                 g->setUIScalingFactor(uiScalingFactor);
+
+            const auto realtimeThreadPolicy = contentPtr->getRealtimeThreadPolicy();
+            const bool realtimeThreadPolicyChanged = (g->getRealtimeThreadPolicy() != realtimeThreadPolicy);
+
+            if (realtimeThreadPolicyChanged)
+                g->setRealtimeThreadPolicy(realtimeThreadPolicy);
+
+            const auto bulkThreadPolicy = contentPtr->getBulkThreadPolicy();
+            const bool bulkThreadPolicyChanged = (g->getBulkThreadPolicy() != bulkThreadPolicy);
+
+            if (bulkThreadPolicyChanged)
+                g->setBulkThreadPolicy(bulkThreadPolicy);
+
+            // These take effect when the engines are prepared to play again.
+            const bool nativeSampleRate = contentPtr->getNativeSampleRate();
+            const bool nativeSampleRateChanged = (g->isNativeSampleRate() != nativeSampleRate);
+
+            if (nativeSampleRateChanged)
+                g->setNativeSampleRate(nativeSampleRate);
+
+            const auto resamplingQuality = contentPtr->getResamplingQuality();
+            const bool resamplingQualityChanged = (g->getResamplingQuality() != resamplingQuality);
+
+            if (resamplingQualityChanged)
+                g->setResamplingQuality(resamplingQuality);
+
+            const int renderAheadSubFrames = contentPtr->getRenderAheadSubFrames();
+            const bool renderAheadChanged = (g->getRenderAheadSubFrames() != renderAheadSubFrames);
+
+            if (renderAheadChanged)
+                g->setRenderAheadSubFrames(renderAheadSubFrames);
+
+            const int limiterLookahead = contentPtr->getLimiterLookahead();
+            const bool limiterLookaheadChanged = (g->getLimiterLookahead() != limiterLookahead);
+
+            if (limiterLookaheadChanged)
+                g->setLimiterLookahead(limiterLookahead);
+
+            const int reverbTailDecimation = contentPtr->getReverbTailDecimation();
+            const bool reverbTailChanged = (g->getReverbTailDecimation() != reverbTailDecimation);
+
+            if (reverbTailChanged)
+                g->setReverbTailDecimation(reverbTailDecimation);
+
+            if (uiScalingFactorChanged || realtimeThreadPolicyChanged || bulkThreadPolicyChanged
+                || nativeSampleRateChanged || resamplingQualityChanged || renderAheadChanged
+                || limiterLookaheadChanged || reverbTailChanged)
                 g->saveSettings();
-            }
 
             box.dismiss();
         };
@@ -115,12 +115,14 @@ void AeolusAudioProcessor::changeProgramName(int /* index */, const juce::String
 void AeolusAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     _engine.prepareToPlay((float)sampleRate, samplesPerBlock);
+
+    // Non zero when rendering ahead of the audio callback.
+    setLatencySamples(_engine.getLatencySamples());
 }
 
 void AeolusAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    _engine.releaseResources();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -232,7 +234,7 @@ void AeolusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::
 #if AEOLUS_MULTIBUS_OUTPUT
 
     _engine.setVolume(_parameters.volume->get());
-    _engine.process(buffer, isNonRealtime());
+    _engine.process(buffer, midiMessages, isNonRealtime());
 
 #else
 
@@ -245,7 +247,7 @@ void AeolusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::
     _engine.setReverbWet(_parameters.reverbWet->get());
     _engine.setVolume(_parameters.volume->get());
     _engine.enableLimiter(_parameters.limiterEnabled->get());
-    _engine.process(outL, outR, buffer.getNumSamples(), isNonRealtime());
+    _engine.process(outL, outR, buffer.getNumSamples(), midiMessages, isNonRealtime());
 
 #endif // AEOLUS_MULTIBUS_OUTPUT
 
@@ -294,9 +296,10 @@ void AeolusAudioProcessor::processMidi(juce::MidiBuffer& midiMessages)
                 break;
             }
         }
-
-        _engine.processMIDIMessage(msg);
     }
+
+    // @note Notes, stops and sequencer messages are applied by the engine
+    //       at their sample position while rendering the block.
 }
 
 //==============================================================================
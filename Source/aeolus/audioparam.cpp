@@ -17,6 +17,7 @@
 //
 // ----------------------------------------------------------------------------
 
+#include <algorithm>
 #include <climits>
 #include "aeolus/audioparam.h"
 
@@ -98,6 +99,56 @@ float AudioParameter::nextValue()
     return _currentValue;
 }
 
+float AudioParameter::nextValue(int numSteps)
+{
+    updateSmoothing();
+
+    if (_smoothing && numSteps > 0) {
+        _currentValue = _targetValue + (_currentValue - _targetValue) * powf(1.0f - _frac, (float) numSteps);
+        updateSmoothing();
+    }
+
+    return _currentValue;
+}
+
+void AudioParameter::nextValues(float* values, int numSteps)
+{
+    // Each step is nextValue() with updateSmoothing() inlined, kept in registers.
+    const float target = _targetValue;
+    const float frac = _frac;
+    float current = _currentValue;
+    bool smoothing = _smoothing;
+
+    for (int i = 0; i < numSteps; ++i) {
+        smoothing = fabsf(current - target) > std::numeric_limits<float>::epsilon();
+
+        if (!smoothing) {
+            current = target;
+        } else {
+            const float prevValue { current };
+            current = target * frac + current * (1.0f - frac);
+
+            if (fabsf(current - prevValue) <= std::numeric_limits<float>::epsilon()) {
+                // No advancement - jump to the target
+                current = target;
+            }
+        }
+
+        values[i] = current;
+    }
+
+    _currentValue = current;
+    _smoothing = smoothing;
+}
+
+AudioParameter::Ramp AudioParameter::nextRamp(int numSteps)
+{
+    const float start = _currentValue;
+    const float end = nextValue(numSteps);
+
+    return { start, numSteps > 0 ? (end - start) / float(numSteps) : 0.0f };
+}
+
 void AudioParameter::updateSmoothing()
 {
     _smoothing = fabsf(_currentValue - _targetValue) > std::numeric_limits<float>::epsilon();
@@ -54,6 +54,22 @@ public:
 
     float nextValue();
 
+    /// Advance the smoothing by the given number of steps at once.
+    float nextValue(int numSteps);
+
+    /// Write the next values, same as calling nextValue() for each of them.
+    void nextValues(float* values, int numSteps);
+
+    /// Linear segment over the next steps: value i is start + (i + 1) * step.
+    struct Ramp
+    {
+        float start;
+        float step;
+    };
+
+    /// Advance the smoothing by the given number of steps, as a linear segment.
+    Ramp nextRamp(int numSteps);
+
     float& targetRef() noexcept { return _targetValue; }
 
 private:
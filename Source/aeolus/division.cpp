@@ -20,6 +20,7 @@
 #include "globals.h"
 #include "division.h"
 #include "engine.h"
+#include "simd.h"
 
 using namespace juce;
 
@@ -43,8 +44,9 @@ Division::Division(Engine& engine, const String& name)
     , _swellFilterSpec{}
     , _swellFilterStateL{}
     , _swellFilterStateR{}
-    , _tremulantDelayL(TREMULANT_DELAY_LENGTH)
-    , _tremulantDelayR(TREMULANT_DELAY_LENGTH)
+    , _swellFilterGain{-1.0f}
+    , _tremulantDelay(TREMULANT_DELAY_LENGTH)
+    , _tremulantDelayLength{(float)TREMULANT_DELAY_LENGTH}
     , _stops{}
     , _activeVoices{}
     , _keysState{}
@@ -62,6 +64,21 @@ Division::Division(Engine& engine, const String& name)
     dsp::BiquadFilter::resetState(_swellFilterSpec, _swellFilterStateR);
 }
 
+void Division::prepareToPlay(float sampleRate)
+{
+    _swellFilterSpec.sampleRate = sampleRate;
+    _swellFilterSpec.freq = jmin(_swellFilterSpec.freq, 0.4f * sampleRate);
+
+    dsp::BiquadFilter::updateSpec(_swellFilterSpec);
+    dsp::BiquadFilter::resetState(_swellFilterSpec, _swellFilterStateL);
+    dsp::BiquadFilter::resetState(_swellFilterSpec, _swellFilterStateR);
+    _swellFilterGain = -1.0f;
+
+    // Keep the tremulant pitch modulation depth the same in time.
+    _tremulantDelayLength = TREMULANT_DELAY_LENGTH * sampleRate / SAMPLE_RATE_F;
+    _tremulantDelay.resize((size_t)std::ceil(_tremulantDelayLength));
+}
+
 void Division::initFromVar(const var& v)
 {
     if (const auto* obj = v.getDynamicObject()) {
@@ -461,6 +478,8 @@ bool Division::process(AudioBuffer<float>& targetBuffer, AudioBuffer<float>& voi
     if (voice == nullptr)
         return false;
 
+#if AEOLUS_MULTIBUS_OUTPUT
+
     while (voice != nullptr) {
         voiceBuffer.clear();
         float* outL = voiceBuffer.getWritePointer(0);
@@ -468,14 +487,10 @@ bool Division::process(AudioBuffer<float>& targetBuffer, AudioBuffer<float>& voi
 
         voice->process(outL, outR);
 
-#if AEOLUS_MULTIBUS_OUTPUT
         // Mix voice to the corresponding output channel depending on the pan-position
         int ch = jlimit(0, targetBuffer.getNumChannels() - 1, int(voice->getPanPosition() * targetBuffer.getNumChannels()));
         targetBuffer.addFrom(ch, 0, voiceBuffer, 0, 0, SUB_FRAME_LENGTH);
-#else
-        targetBuffer.addFrom(0, 0, voiceBuffer, 0, 0, SUB_FRAME_LENGTH);
-        targetBuffer.addFrom(1, 0, voiceBuffer, 1, 0, SUB_FRAME_LENGTH);
-#endif
+
         if (voice->isOver()) {
             auto* nextVoice = _activeVoices.removeAndReturnNext(voice);
             voice->resetAndReturnToPool();
@@ -485,9 +500,88 @@ bool Division::process(AudioBuffer<float>& targetBuffer, AudioBuffer<float>& voi
         }
     }
 
+#else
+
+    ignoreUnused(voiceBuffer);
+
+    float* outL = targetBuffer.getWritePointer(0);
+    float* outR = targetBuffer.getWritePointer(1);
+
+    while (voice != nullptr) {
+        Voice* batch[VoiceBatchSize];
+        int numVoices = 0;
+
+        while (voice != nullptr && numVoices < VoiceBatchSize) {
+            batch[numVoices++] = voice;
+            voice = voice->next();
+        }
+
+        processVoiceBatch(batch, numVoices, outL, outR);
+
+        for (int i = 0; i < numVoices; ++i) {
+            if (batch[i]->isOver()) {
+                _activeVoices.remove(batch[i]);
+                batch[i]->resetAndReturnToPool();
+            }
+        }
+    }
+
+#endif
+
     return true;
 }
 
+void Division::processVoiceBatch(Voice* const* voices, int numVoices, float* outL, float* outR)
+{
+    jassert(numVoices > 0 && numVoices <= VoiceBatchSize);
+
+    // Voices are interleaved (transposed), each in its own lane.
+    constexpr int numLanes = dsp::BiquadBank::NumLanes;
+    float left[SUB_FRAME_LENGTH * numLanes];
+    float right[SUB_FRAME_LENGTH * numLanes];
+
+    dsp::BiquadBank bankL;
+    dsp::BiquadBank bankR;
+
+    if (numVoices < numLanes) {
+        ::memset(left, 0, sizeof(left));
+        ::memset(right, 0, sizeof(right));
+    }
+
+    for (int k = 0; k < numVoices; ++k) {
+        auto& spatial = voices[k]->getSpatialSource();
+        voices[k]->processUnfiltered(left + k, right + k, numLanes);
+
+        bankL.load(k, spatial.getFilterSpec(0), spatial.getFilterState(0));
+        bankR.load(k, spatial.getFilterSpec(1), spatial.getFilterState(1));
+    }
+
+    bankL.process(left, SUB_FRAME_LENGTH);
+    bankR.process(right, SUB_FRAME_LENGTH);
+
+    for (int k = 0; k < numVoices; ++k) {
+        auto& spatial = voices[k]->getSpatialSource();
+        bankL.store(k, spatial.getFilterState(0));
+        bankR.store(k, spatial.getFilterState(1));
+    }
+
+    // Mixed in the voices order
+    for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
+        const float* frameL = left + i * numLanes;
+        const float* frameR = right + i * numLanes;
+        float l = outL[i];
+        float r = outR[i];
+
+        for (int k = 0; k < numVoices; ++k) {
+            l += frameL[k];
+            r += frameR[k];
+        }
+
+        outL[i] = l;
+        outR[i] = r;
+    }
+}
+
 void Division::modulate(juce::AudioBuffer<float>& targetBuffer, const juce::AudioBuffer<float>& tremulantBuffer)
 {
     jassert(targetBuffer.getNumSamples() == SUB_FRAME_LENGTH);
@@ -502,31 +596,17 @@ void Division::modulate(juce::AudioBuffer<float>& targetBuffer, const juce::Audi
     auto& paramGain = _params[Division::GAIN];
     paramGain.setValue(_paramGain->get());
 
-#if AEOLUS_MULTIBUS_OUTPUT
-
-    if (paramGain.isSmoothing()) {
-
-        for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
-            const float g = (1.0f + gain[i] * lvl) * paramGain.nextValue();
-
-            for (int ch = 0; ch < targetBuffer.getNumChannels(); ++ch) {
-                targetBuffer.getWritePointer(ch)[i] *= g;
-            }
-        }
+    // Smoothed gain modulated by the tremulant
+    float g[SUB_FRAME_LENGTH];
+    paramGain.nextValues(g, SUB_FRAME_LENGTH);
 
-    } else {
-        // Gain is stable
-        const float pgain = paramGain.target();
+    for (int i = 0; i < SUB_FRAME_LENGTH; ++i)
+        g[i] *= 1.0f + gain[i] * lvl;
 
-        for (int ch = 0; ch < targetBuffer.getNumChannels(); ++ch) {
-            float* const out = targetBuffer.getWritePointer(ch);
+#if AEOLUS_MULTIBUS_OUTPUT
 
-            for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
-                float g = (1.0f + gain[i] * lvl) * pgain;
-                out[i] *= g;
-            }
-        }
-    }
+    for (int ch = 0; ch < targetBuffer.getNumChannels(); ++ch)
+        simd::mul(targetBuffer.getWritePointer(ch), g, SUB_FRAME_LENGTH);
 
     // No swell filtering for multibus
 
@@ -538,28 +618,32 @@ void Division::modulate(juce::AudioBuffer<float>& targetBuffer, const juce::Audi
     jassert(outL != nullptr);
     jassert(outR != nullptr);
 
-    for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
-        _tremulantDelayL.write(outL[i]);
-        _tremulantDelayR.write(outR[i]);
+    // Frequency modulation delays
+    const float freqModCenter = _tremulantDelayLength * 0.5f;
+    const float freqModAmp = _tremulantDelayLength * 0.5f * TREMULANT_DELAY_MODULATION_LEVEL;
+    float delays[SUB_FRAME_LENGTH];
 
-        const float g = (1.0f + gain[i] * lvl) * paramGain.nextValue();
+    for (int i = 0; i < SUB_FRAME_LENGTH; ++i)
+        delays[i] = freqModCenter + freqModAmp * (0.5f - gain[i] * lvl);
 
-        constexpr float freqModCenter = TREMULANT_DELAY_LENGTH * 0.5f;
-        constexpr float freqModAmp = TREMULANT_DELAY_LENGTH * 0.5f * TREMULANT_DELAY_MODULATION_LEVEL;
+    _tremulantDelay.process(outL, outR, delays, SUB_FRAME_LENGTH);
 
-        const float p = freqModCenter + freqModAmp * (0.5f - gain[i] * lvl);
-        outL[i] = _tremulantDelayL.read(p) * g;
-        outR[i] = _tremulantDelayR.read(p) * g;
-    }
+    simd::mul(outL, g, SUB_FRAME_LENGTH);
+    simd::mul(outR, g, SUB_FRAME_LENGTH);
 
     // Apply swell filter
     if (hasSwell()) {
-        // Close the filter along with the gain
-        const float k = powf(jlimit(0.0f, 1.0f, paramGain.target()), 1.3f);
-        _swellFilterSpec.freq = jmap(k, 400.0f, 18000.0f);
-        dsp::BiquadFilter::updateSpec(_swellFilterSpec);
-        dsp::BiquadFilter::process(_swellFilterSpec, _swellFilterStateL, outL, outL, SUB_FRAME_LENGTH);
-        dsp::BiquadFilter::process(_swellFilterSpec, _swellFilterStateR, outR, outR, SUB_FRAME_LENGTH);
+        // Close the filter along with the gain, redesigned only when the gain moves.
+        const float swellGain = jlimit(0.0f, 1.0f, paramGain.target());
+
+        if (swellGain != _swellFilterGain) {
+            const float k = powf(swellGain, 1.3f);
+            _swellFilterSpec.freq = jmap(k, 400.0f, 18000.0f);
+            dsp::BiquadFilter::updateSpec(_swellFilterSpec);
+            _swellFilterGain = swellGain;
+        }
+
+        dsp::BiquadFilter::processStereo(_swellFilterSpec, _swellFilterStateL, _swellFilterStateR, outL, outR, SUB_FRAME_LENGTH);
     }
 #endif
 }
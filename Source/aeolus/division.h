@@ -80,6 +80,12 @@ public:
     juce::var getPersistentState() const;
     void setPersistentState(const juce::var& v);
 
+    /**
+     * Set the rate the division is rendered at.
+     * This must not be called while processing.
+     */
+    void prepareToPlay(float sampleRate);
+
     Engine& getEngine() noexcept { return _engine; }
 
     juce::String getName() const { return _name; }
@@ -144,6 +150,9 @@ public:
     void noteOff(int note, int midiChannel);
     void allNotesOff();
 
+    /// Whether any of the division's own keys is held.
+    bool hasKeysPressed() const noexcept { return _keysState.any(); }
+
     void handleControlMessage(const juce::MidiMessage& msg);
 
     bool process(juce::AudioBuffer<float>& targetBuffer, juce::AudioBuffer<float>& voiceBuffer);
@@ -179,6 +188,12 @@ private:
 
     bool isAlreadyVoiced(int stopIndex, int node);
 
+    /// Number of voices rendered together, their spatial filters being processed in SIMD lanes.
+    constexpr static int VoiceBatchSize = dsp::BiquadBank::NumLanes;
+
+    /// Render a batch of stereo voices, and mix them to the output.
+    void processVoiceBatch(Voice* const* voices, int numVoices, float* outL, float* outR);
+
     Engine& _engine;
 
     juce::String _name;     ///< The division name.
@@ -207,10 +222,11 @@ private:
     dsp::BiquadFilter::Spec _swellFilterSpec;
     dsp::BiquadFilter::State _swellFilterStateL;
     dsp::BiquadFilter::State _swellFilterStateR;
+    float _swellFilterGain;     ///< Gain the swell filter has been designed for.
 
-    /// Delay lines used for tremulant frequency modulation.
-    dsp::DelayLine _tremulantDelayL;
-    dsp::DelayLine _tremulantDelayR;
+    /// Delay used for tremulant frequency modulation.
+    dsp::ModulatedDelay _tremulantDelay;
+    float _tremulantDelayLength;    ///< Modulation delay length at the rendering rate (in samples).
 
     std::vector<Stop> _stops;   ///< All the stops this division has.
 
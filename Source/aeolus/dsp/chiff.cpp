@@ -34,6 +34,7 @@ Chiff::Chiff()
     , _lpSpec{}
     , _lpState{}
     , _gain{1.0f}
+    , _sampleRate{SAMPLE_RATE_F}
 {
 
     _lpSpec.type = BiquadFilter::LowPass;
@@ -67,10 +68,16 @@ void Chiff::setGain(float v)
     _gain = v;
 }
 
+void Chiff::setSampleRate(float sampleRate)
+{
+    _sampleRate = sampleRate;
+    _lpSpec.sampleRate = sampleRate;
+}
+
 void Chiff::setFrequency(float f)
 {
-    _pipeDelay = SAMPLE_RATE / f;
-    _lpSpec.freq = jmin(0.45f * SAMPLE_RATE, f * 4.0f);
+    _pipeDelay = _sampleRate / f;
+    _lpSpec.freq = jmin(0.45f * _sampleRate, f * 4.0f);
 }
 
 void Chiff::reset()
@@ -81,9 +88,9 @@ void Chiff::reset()
 
 void Chiff::trigger()
 {
-    _noiseEnvelope.trigger({0.01f, 0.0f, 1.0f, 0.02f});
+    _noiseEnvelope.trigger({0.01f, 0.0f, 1.0f, 0.02f}, _sampleRate);
 
-    _envelope.trigger(_envelopeTrigger);
+    _envelope.trigger(_envelopeTrigger, _sampleRate);
 
     _pipeResonator.reset();
     BiquadFilter::updateSpec(_lpSpec);
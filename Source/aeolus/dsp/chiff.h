@@ -44,6 +44,9 @@ public:
     void setSustain(float v);
     void setRelease(float v);
     void setGain(float v);
+
+    /// Set the sample rate, before the frequency.
+    void setSampleRate(float sampleRate);
     void setFrequency(float f);
 
     void reset();
@@ -69,6 +72,7 @@ private:
     BiquadFilter::State _lpState;
 
     float _gain;
+    float _sampleRate;
 };
 
 } // namespace dsp
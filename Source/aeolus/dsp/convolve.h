@@ -25,30 +25,49 @@
 #include "aeolus/worker.h"
 #include "aeolus/dsp/fft.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cassert>
 #include <atomic>
+#include <memory>
 #include <vector>
 
 AEOLUS_NAMESPACE_BEGIN
 
 namespace dsp {
 
+/// Whether all the samples are zero.
+inline bool isSilent(const float* x, size_t n) noexcept
+{
+    for (size_t i = 0; i < n; ++i) {
+        if (x[i] != 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
 struct ConvPartBase
 {
     float* irBuffer = nullptr;
     float* inputBuffer = nullptr;
     size_t inputSize = 0;
-    size_t readIndex = 0;
 
     void init(float* ir, float* input, size_t size)
     {
         assert(input != nullptr);
         assert(ir != nullptr);
+        assert(math::isPowerOfTwo(size));
 
         irBuffer    = ir;
         inputBuffer = input;
         inputSize   = size;
-        readIndex   = (size - 1) % inputSize;
+    }
+
+    /// Input sample which is k samples older than the one at position pos.
+    inline float input(size_t pos, size_t k) const noexcept
+    {
+        return inputBuffer[(pos - k) & (inputSize - 1)];
     }
 };
 
@@ -95,9 +114,14 @@ struct Conv<PrevLength, Part, Parts...>
         tail.init(&ir[Part::Length], input, size);
     }
 
-    inline float tick()
+    /**
+     * Accumulate n output samples into out.
+     * @param pos Input buffer position of the first sample of the block.
+     */
+    inline void process(size_t pos, float* out, size_t n)
     {
-        return part.tick() + tail.tick();
+        part.process(pos, out, n);
+        tail.process(pos, out, n);
     }
 };
 
@@ -127,9 +151,9 @@ struct Conv<PrevLength, Part>
         part.init(ir, input, size);
     }
 
-    inline float tick()
+    inline void process(size_t pos, float* out, size_t n)
     {
-        return part.tick();
+        part.process(pos, out, n);
     }
 };
 
@@ -143,23 +167,27 @@ struct FIR : public ConvPart<L>
 
     void reset()
     {
-        ConvPartBase::readIndex = 0;
     }
 
-    inline float tick()
+    inline void process(size_t pos, float* out, size_t n)
     {
-        float y = 0.0f;
+        const size_t mask = ConvPartBase::inputSize - 1;
 
-        if (ConvPartBase::readIndex + Length < ConvPartBase::inputSize) {
-            y = simd::mul_reduce_unaligned(ConvPartBase::irBuffer, &ConvPartBase::inputBuffer[ConvPartBase::readIndex], Length);
-        } else {
-            for (size_t i = 0; i < Length; ++i)
-                y += ConvPartBase::irBuffer[i] * ConvPartBase::inputBuffer[(ConvPartBase::readIndex + i) % ConvPartBase::inputSize];
-        }
+        for (size_t j = 0; j < n; ++j) {
+            // Input is stored backwards, so the history is contiguous
+            const size_t idx = (pos - j) & mask;
 
-        ConvPartBase::readIndex = (ConvPartBase::readIndex - 1) % ConvPartBase::inputSize;
+            if (idx + Length <= ConvPartBase::inputSize) {
+                out[j] += simd::mul_reduce_unaligned(ConvPartBase::irBuffer, &ConvPartBase::inputBuffer[idx], Length);
+            } else {
+                float y = 0.0f;
 
-        return y;
+                for (size_t i = 0; i < Length; ++i)
+                    y += ConvPartBase::irBuffer[i] * ConvPartBase::inputBuffer[(idx + i) & mask];
+
+                out[j] += y;
+            }
+        }
     }
 };
 
@@ -169,22 +197,21 @@ struct FFT : public ConvPart<L>
     constexpr static size_t Delay = L;
     constexpr static size_t Length = L;
     constexpr static size_t Length2 = Length * 2;
-    constexpr static size_t Length4 = Length * 4;
 
-    float* complexInputBuffer;
-    float* complexIrBuffer;
+    float* blockBuffer;     ///< Input block, its spectrum, and the output.
+    float* irSpectrum;
 
     bool irReady = false;
     float* tailBuffer;
     size_t tailIndex;
 
-    using FftImpl = GFFT<Length2, float>;
+    using FftImpl = GRFFT<Length2, float>;
 
     FFT()
     {
-        complexInputBuffer = (float*) AlignedMemory<32>::alloc(Length4 * sizeof(float));
-        complexIrBuffer    = (float*) AlignedMemory<32>::alloc(Length4 * sizeof(float));
-        tailBuffer         = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+        blockBuffer = (float*) AlignedMemory<32>::alloc(Length2 * sizeof(float));
+        irSpectrum  = (float*) AlignedMemory<32>::alloc(Length2 * sizeof(float));
+        tailBuffer  = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
 
         reset();
     }
@@ -192,73 +219,68 @@ struct FFT : public ConvPart<L>
     ~FFT()
     {
         AlignedMemory<32>::free(tailBuffer);
-        AlignedMemory<32>::free(complexIrBuffer);
-        AlignedMemory<32>::free(complexInputBuffer);
+        AlignedMemory<32>::free(irSpectrum);
+        AlignedMemory<32>::free(blockBuffer);
     }
 
     void reset()
     {
-        ::memset(complexInputBuffer, 0, sizeof(float) * Length4);
-        ::memset(complexIrBuffer,    0, sizeof(float) * Length4);
-        ::memset(tailBuffer,         0, sizeof(float) * Length);
+        ::memset(blockBuffer, 0, sizeof(float) * Length2);
+        ::memset(irSpectrum,  0, sizeof(float) * Length2);
+        ::memset(tailBuffer,  0, sizeof(float) * Length);
 
         tailIndex = 0;
         irReady = false;
     }
 
-    inline float tick()
+    inline void process(size_t pos, float* out, size_t n)
     {
-        float y = complexInputBuffer[tailIndex * 2];
+        size_t j = 0;
 
-        // Feed from input buffer
-        const size_t idx = (ConvPartBase::readIndex - tailIndex) % ConvPartBase::inputSize;
+        while (j < n) {
+            // Stay within the current block, so that it is convolved only once full
+            const size_t k = jmin(n - j, Length - tailIndex);
+            float* buffer = &blockBuffer[tailIndex];
 
-        complexInputBuffer[tailIndex * 2] = ConvPartBase::inputBuffer[idx];
-        complexInputBuffer[tailIndex * 2 + 1] = 0.0f;
+            for (size_t i = 0; i < k; ++i) {
+                // Output of the previous block is stored in place of the input
+                out[j + i] += buffer[i];
+                buffer[i] = ConvPartBase::input(pos, j + i);
+            }
 
-        tailIndex = (tailIndex + 1) % Length;
+            j += k;
+            tailIndex += k;
 
-        if (tailIndex == 0) {
-            convolve();
-            ConvPartBase::readIndex = (ConvPartBase::readIndex - Length) % ConvPartBase::inputSize;
+            if (tailIndex == Length) {
+                tailIndex = 0;
+                convolve();
+            }
         }
-
-        return y;
     }
 
     void convolve()
     {
         if (! irReady) {
-            size_t j = 0;
+            ::memcpy(irSpectrum, ConvPartBase::irBuffer, sizeof(float) * Length);
+            ::memset(&irSpectrum[Length], 0, sizeof(float) * Length);
 
-            for (size_t i = 0; i < Length; ++i) {
-                complexIrBuffer[j++] = ConvPartBase::irBuffer[i];
-                complexIrBuffer[j++] = 0.0f;
-            }
-
-            FftImpl::fft_real_padded(complexIrBuffer);
+            FftImpl::fft(irSpectrum);
 
             irReady = true;
         }
 
-        ::memset(&complexInputBuffer[Length2], 0, sizeof(float) * Length2);
-
-        FftImpl::fft_real_padded(complexInputBuffer);
+        ::memset(&blockBuffer[Length], 0, sizeof(float) * Length);
 
-        simd::complex_mul_conj(complexInputBuffer, complexInputBuffer, complexIrBuffer, Length4);
-
-        FftImpl::fft(complexInputBuffer);
+        FftImpl::fft(blockBuffer);
+        FftImpl::mul(blockBuffer, blockBuffer, irSpectrum);
+        FftImpl::ifft(blockBuffer);
 
         // Add tail buffer from previous convolution
-        size_t tail = 0;
-
-        for (size_t i = 0; i < Length2; i += 2) {
-            constexpr float norm = 1.0f / Length2;
+        constexpr float norm = 1.0f / Length2;
 
-            // Put output samples together without interleaving
-            complexInputBuffer[i] = norm * (complexInputBuffer[i] + tailBuffer[tail]);
-            tailBuffer[tail] = complexInputBuffer[Length2 + i];
-            ++tail;
+        for (size_t i = 0; i < Length; ++i) {
+            blockBuffer[i] = norm * (blockBuffer[i] + tailBuffer[i]);
+            tailBuffer[i] = blockBuffer[Length + i];
         }
     }
 };
@@ -289,6 +311,8 @@ struct CascadeConvolver : public Conv<0, Parts...>
 
     void init(float* ir, float* input, size_t size)
     {
+        assert(math::isPowerOfTwo(size));
+
         irBuffer    = ir;
         irIndex     = 0;
         inputBuffer = input;
@@ -301,22 +325,144 @@ struct CascadeConvolver : public Conv<0, Parts...>
     inline void reset()
     {
         irIndex = 0;
-        inputIndex = inputSize - 1;
+        inputIndex = 0;
 
         Parent::reset();
     }
 
+    /**
+     * Convolve a block of samples.
+     * @note Block must not be longer than half of the input buffer,
+     *       so that the history needed by the FIR part is preserved.
+     */
+    inline void process(const float* in, float* out, size_t n)
+    {
+        assert(n <= inputSize / 2);
+
+        // Input is stored backwards
+        const size_t pos = (inputIndex - 1) & (inputSize - 1);
+
+        for (size_t i = 0; i < n; ++i) {
+            inputIndex = (inputIndex - 1) & (inputSize - 1);
+            inputBuffer[inputIndex] = in[i];
+        }
+
+        std::fill(out, out + n, 0.0f);
+        Parent::process(pos, out, n);
+    }
+
     inline float tick(float x)
     {
-        inputIndex = (inputIndex - 1) % inputSize;
-        inputBuffer[inputIndex] = x;
+        float y;
+        process(&x, &y, 1);
 
-        return Parent::tick();
+        return y;
     }
 };
 
 //----------------------------------------------------------
 
+/**
+ * @brief Spectra of uniform IR partitions.
+ *
+ * Each partition is zero-padded to twice its length and transformed.
+ * The spectra are read-only once the IR has been fed, so that they can
+ * be shared between convolvers rendering the same IR.
+ */
+template <size_t L>
+class PartitionedIR final
+{
+public:
+
+    static_assert(math::isPowerOfTwo(L), "Block length must be a power of two");
+
+    constexpr static size_t Length = L;
+    constexpr static size_t Length2 = 2 * Length;
+    constexpr static size_t SpectrumSize = Length2;
+
+    using FftImpl = GRFFT<Length2>;
+
+    explicit PartitionedIR(size_t n = 0)
+        : numPartitions{n}
+        , spectra{nullptr}
+        , inputIndex{0}
+        , numReady{0}
+        , zero(n, 1)
+    {
+        spectra = (float*) AlignedMemory<32>::alloc(numPartitions * SpectrumSize * sizeof(float));
+        ::memset(spectra, 0, sizeof(float) * numPartitions * SpectrumSize);
+    }
+
+    ~PartitionedIR()
+    {
+        AlignedMemory<32>::free(spectra);
+    }
+
+    PartitionedIR(const PartitionedIR&) = delete;
+    PartitionedIR& operator = (const PartitionedIR&) = delete;
+
+    size_t size() const noexcept { return numPartitions; }
+
+    /// Number of partitions with spectrum ready.
+    size_t ready() const noexcept { return numReady; }
+
+    /// Whether the partition is all zeros, so that it can be skipped.
+    bool isZero(size_t i) const noexcept { return zero[i] != 0; }
+
+    size_t getMemoryUsage() const noexcept { return numPartitions * SpectrumSize * sizeof(float); }
+
+    const float* partition(size_t i) const noexcept
+    {
+        assert(i < numPartitions);
+        return &spectra[i * SpectrumSize];
+    }
+
+    void feed(float x)
+    {
+        assert(numReady < numPartitions);
+
+        spectra[inputIndex] = x;
+        ++inputIndex;
+
+        if (inputIndex % SpectrumSize == Length) {
+            // IR input chunk is ready - compute ir Chunk spectrum (padding is already zero)
+            zero[numReady] = isSilent(&spectra[numReady * SpectrumSize], Length);
+            FftImpl::fft(&spectra[numReady * SpectrumSize]);
+
+            ++numReady;
+            inputIndex += Length;
+        }
+    }
+
+    /// Feed n samples from ir, reading past its end as zeros.
+    void feed(const float* ir, size_t irLength, size_t offset, size_t n)
+    {
+        for (size_t i = offset; i < offset + n; ++i)
+            feed(i < irLength ? ir[i] : 0.0f);
+    }
+
+private:
+
+    size_t numPartitions;
+    float* spectra;
+    size_t inputIndex;
+    size_t numReady;
+    std::vector<uint8_t> zero;
+};
+
+//----------------------------------------------------------
+
+/**
+ * @brief Uniformly partitioned convolver.
+ *
+ * Spectra of the past input blocks are kept in a frequency-domain delay line,
+ * so that products of all the partitions are accumulated in the frequency
+ * domain and transformed back with a single inverse FFT per block.
+ *
+ * Partitions other than the first one only depend on the past input,
+ * so they are accumulated in advance, during the preceding block,
+ * by the worker jobs (each job handles a contiguous segment of partitions).
+ */
 template <size_t L>
 class EquallyPartitionedConvolver final
 {
@@ -326,305 +472,948 @@ public:
 
     constexpr static size_t Length = L;
     constexpr static size_t Length2 = 2 * Length;
-    constexpr static size_t Length4 = 4 * Length;
 
-    using FftImpl = GFFT<Length2>;
+    /// Packed spectrum of a zero-padded block (in number of floats).
+    constexpr static size_t SpectrumSize = Length2;
+
+    /// Maximum number of jobs the partitions are split into.
+    constexpr static size_t MaxSegments = 4;
+
+    using FftImpl = GRFFT<Length2>;
+
+    using IR = PartitionedIR<L>;
 
     EquallyPartitionedConvolver (size_t n = 0)
-        : inputIndex{0}
+        : numPartitions{n}
+        , inputIndex{0}
         , inputSpectrumBuffer{nullptr}
-        , inputSpectrumBufferSize{Length4 * n}
+        , inputSpectrumBufferSize{SpectrumSize * n}
         , inputSpectrumIndex{0}
-        , irSpectrumBuffer{nullptr}
-        , irSpectrumBufferSize{Length4 * n}
-        , irInputIndex{0}
-        , irInputBlockIndex{0}
-        , blocks{n}
+        , silentBlocks(n, 1)
+        , numActiveBlocks{0}
+        , ir{}
+        , numIrPartitions{0}
+        , worker{nullptr}
+        , segments{}
     {
-
         inputSpectrumBuffer = (float*) AlignedMemory<32>::alloc(inputSpectrumBufferSize * sizeof(float));
-        irSpectrumBuffer = (float*) AlignedMemory<32>::alloc(irSpectrumBufferSize * sizeof(float));
+        accumulator = (float*) AlignedMemory<32>::alloc(SpectrumSize * sizeof(float));
+        outputBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+        tailBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
 
+        allocateSegments();
         reset();
     }
 
     ~EquallyPartitionedConvolver()
     {
         setWorker (nullptr);
-        AlignedMemory<32>::free(irSpectrumBuffer);
+        AlignedMemory<32>::free(tailBuffer);
+        AlignedMemory<32>::free(outputBuffer);
+        AlignedMemory<32>::free(accumulator);
         AlignedMemory<32>::free(inputSpectrumBuffer);
     }
 
     void resize(size_t n)
     {
-        if (n * Length4 != irSpectrumBufferSize) {
-            AlignedMemory<32>::free(irSpectrumBuffer);
-            irSpectrumBufferSize = n * Length4;
-            irSpectrumBuffer = (float*) AlignedMemory<32>::alloc(irSpectrumBufferSize * sizeof(float));
-        }
+        cancelJobs();
 
-        if (n * Length4 != inputSpectrumBufferSize) {
+        if (n * SpectrumSize != inputSpectrumBufferSize) {
             AlignedMemory<32>::free(inputSpectrumBuffer);
-            inputSpectrumBufferSize = Length4 * n;
+            inputSpectrumBufferSize = SpectrumSize * n;
             inputSpectrumBuffer = (float*) AlignedMemory<32>::alloc(inputSpectrumBufferSize * sizeof(float));
         }
 
-        blocks.resize(n);
+        silentBlocks.assign(n, 1);
+
+        numPartitions = n;
+        allocateSegments();
 
         reset();
     }
 
     void setWorker(Worker* w)
     {
-        for (auto& block : blocks)
-            block.worker = w;
+        cancelJobs();
+        worker = w;
     }
 
     void reset()
     {
+        cancelJobs();
+
         inputIndex = 0;
 
         ::memset(inputSpectrumBuffer, 0, sizeof(float) * inputSpectrumBufferSize);
         inputSpectrumIndex = 0;
 
-        ::memset(irSpectrumBuffer, 0, sizeof(float) * irSpectrumBufferSize);
-        irInputIndex = 0;
+        std::fill(silentBlocks.begin(), silentBlocks.end(), 1);
+        numActiveBlocks = 0;
 
-        irInputBlockIndex = 0;
+        ::memset(accumulator,  0, sizeof(float) * SpectrumSize);
+        ::memset(outputBuffer, 0, sizeof(float) * Length);
+        ::memset(tailBuffer,   0, sizeof(float) * Length);
+    }
 
-        size_t preconvolveIndex = 0;
-        const size_t preconvolveIndexStep = blocks.empty() ? 0 : Length / blocks.size();
+    /**
+     * Set the IR partitions spectra, which may be shared with other convolvers.
+     * The convolver is resized to the number of partitions.
+     */
+    void setIr(std::shared_ptr<const IR> spectra)
+    {
+        resize(spectra != nullptr ? spectra->size() : 0);
 
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            blocks[i].inputSpectrumPtr = &inputSpectrumBuffer[i * Length4];
-            blocks[i].irSpectrumPtr = &irSpectrumBuffer[i * Length4];
-            blocks[i].preconvolveIndex = preconvolveIndex;
-            preconvolveIndex += preconvolveIndexStep;
-            blocks[i].reset();
-        }
+        ir = std::move(spectra);
+        numIrPartitions = ir != nullptr ? ir->ready() : 0;
     }
 
-    void feedIr(float x)
+    /**
+     * Convolve a block of samples of any length.
+     * Input spectrum (and the convolution) is computed only when
+     * the block boundary is reached.
+     */
+    void process(const float* in, float* out, size_t n)
     {
-        assert(irInputIndex < irSpectrumBufferSize);
-        assert(irInputBlockIndex < blocks.size());
+        size_t j = 0;
 
-        irSpectrumBuffer[irInputIndex] = x;
-        irInputIndex += 2;
+        while (j < n) {
+            const size_t k = jmin(n - j, Length - inputIndex);
 
-        if (irInputIndex % Length2 == 0) {
-            // IR input chunk is ready - compute ir Chunk spectrum
-            blocks[irInputBlockIndex].irFft();
+            if (exchange(&in[j], &out[j], k)) {
+                // Input is ready - compute input spectrum
+                inputFft();
+            }
 
-            ++irInputBlockIndex;
-            irInputIndex += Length2;
+            j += k;
         }
     }
 
     float tick(float x)
     {
-        float y = 0.0f;
+        float y;
+        process(&x, &y, 1);
+
+        return y;
+    }
+
+    void inputFft()
+    {
+        clearInputPadding();
 
-        for (auto& block : blocks)
-            y += block.tick();
+        if (!checkInputBlock())
+            FftImpl::fft(inputBlock());
 
-        inputSpectrumBuffer[inputSpectrumIndex + 2 * inputIndex] = x;
-        inputSpectrumBuffer[inputSpectrumIndex + 2 * inputIndex + 1] = 0.0f;
-        ++inputIndex;
+        if (accumulateSpectrum())
+            FftImpl::ifft(accumulator);
 
-        if (inputIndex >= Length) {
-            // Input is ready - compute input spectrum
-            inputIndex = 0;
-            inputFft();
+        finishBlock();
+    }
+
+private:
+
+    template <size_t> friend class StereoPartitionedConvolver;
+
+    //------------------------------------------------------
+
+    /**
+     * @brief Accumulates a range of partitions.
+     */
+    struct Segment final : public Worker::Job
+    {
+        EquallyPartitionedConvolver* owner = nullptr;
+        float* accumulator = nullptr;
+        size_t first = 0;               ///< First partition.
+        size_t last = 0;                ///< Past the last partition.
+        size_t inputSpectrumIndex = 0;  ///< Input spectrum of the block being collected.
+        bool scheduled = false;
+        bool active = false;            ///< Whether anything has been accumulated.
+
+        Segment()
+        {
+            accumulator = (float*) AlignedMemory<32>::alloc(SpectrumSize * sizeof(float));
         }
 
-        return y;
+        Segment(const Segment&) = delete;
+        Segment& operator = (const Segment&) = delete;
+
+        ~Segment()
+        {
+            AlignedMemory<32>::free(accumulator);
+        }
+
+        // Job
+        void run() override
+        {
+            ::memset(accumulator, 0, sizeof(float) * SpectrumSize);
+            active = owner->accumulate(accumulator, first, last, inputSpectrumIndex) > 0;
+        }
+    };
+
+    void allocateSegments()
+    {
+        const size_t n = numPartitions > 1 ? jmin(MaxSegments, numPartitions - 1) : 0;
+
+        if (segments.size() != n) {
+            segments.clear();
+
+            for (size_t i = 0; i < n; ++i) {
+                segments.push_back(std::make_unique<Segment>());
+                segments.back()->owner = this;
+            }
+        }
     }
 
-    void inputFft()
+    /**
+     * Accumulate products of the partitions [first, last)
+     * with their corresponding past input spectra.
+     * Partitions facing a silent input block are skipped.
+     * @param index Index of the input block being collected (its partition 0 spectrum).
+     * @return Number of products accumulated.
+     */
+    size_t accumulate(float* acc, size_t first, size_t last, size_t index) const
     {
-        // Clear padding
-        ::memset(&inputSpectrumBuffer[inputSpectrumIndex + Length2], 0, sizeof (float) * Length2);
+        last = jmin(last, numIrPartitions);
+        size_t count = 0;
 
-        FftImpl::fft_real_padded(&inputSpectrumBuffer[inputSpectrumIndex]);
+        for (size_t i = first; i < last; ++i) {
+            const size_t slot = (index + i * SpectrumSize) % inputSpectrumBufferSize;
 
-        // Perform blocks convolution
-        convolveBlocks();
+            if (silentBlocks[slot / SpectrumSize] || ir->isZero(i))
+                continue;
 
-        // Rotate blocks input spectra
-        float* lastBlockInputSpectrumPtr = blocks[blocks.size() - 1].inputSpectrumPtr;
+            FftImpl::mul_add(acc, &inputSpectrumBuffer[slot], ir->partition(i));
+            ++count;
+        }
 
-        for (size_t i = blocks.size() - 1; i > 0; --i)
-            blocks[i].inputSpectrumPtr = blocks[i - 1].inputSpectrumPtr;
+        return count;
+    }
 
-        blocks[0].inputSpectrumPtr = lastBlockInputSpectrumPtr;
+    /**
+     * Flag the input block just collected as silent or not.
+     * A silent block is left as is, since its spectrum is all zeros too.
+     * @return true if the block is silent.
+     */
+    bool checkInputBlock()
+    {
+        const bool silent = isSilent(inputBlock(), Length);
+        auto& flag = silentBlocks[inputSpectrumIndex / SpectrumSize];
 
-        // Move input spectrum index to the next chunk
-        inputSpectrumIndex = inputSpectrumIndex == 0 ? inputSpectrumBufferSize - Length4
-            : inputSpectrumIndex - Length4;
+        if (flag && !silent)
+            ++numActiveBlocks;
+        else if (!flag && silent)
+            --numActiveBlocks;
 
-        // First block receives fresh input signal and cannot be dephased.
-        blocks[0].dephase = false;
+        flag = silent;
+        return silent;
     }
 
-    void convolveBlocks()
+    /**
+     * Exchange n samples within the current block: the output is copied to out,
+     * and the input is taken from in.
+     * @return true if the input block is complete.
+     */
+    bool exchange(const float* in, float* out, size_t n)
     {
-        for (auto& block : blocks)
-            block.convolve();
+        assert(inputIndex + n <= Length);
+
+        ::memcpy(out, &outputBuffer[inputIndex], sizeof(float) * n);
+        ::memcpy(&inputSpectrumBuffer[inputSpectrumIndex + inputIndex], in, sizeof(float) * n);
+
+        inputIndex += n;
+
+        if (inputIndex < Length)
+            return false;
+
+        inputIndex = 0;
+        return true;
     }
 
-private:
-    //------------------------------------------------------
+    float* inputBlock() noexcept { return &inputSpectrumBuffer[inputSpectrumIndex]; }
+
+    void clearInputPadding()
+    {
+        ::memset(&inputSpectrumBuffer[inputSpectrumIndex + Length], 0, sizeof (float) * Length);
+    }
 
-    struct Block final : public Worker::Job
+    /**
+     * Accumulate the spectrum of the output block.
+     * @return false if the spectrum is all zeros.
+     */
+    bool accumulateSpectrum()
     {
-        Worker* worker = nullptr;
-        float* inputSpectrumPtr = nullptr;
-        float* irSpectrumPtr = nullptr;
+        bool active = false;
 
-        float* convolutionBuffer;
-        float* outputBuffer;
-        float* tailBuffer;
+        // First partition convolves the fresh input
+        if (numIrPartitions > 0 && !silentBlocks[inputSpectrumIndex / SpectrumSize] && !ir->isZero(0)) {
+            FftImpl::mul(accumulator, &inputSpectrumBuffer[inputSpectrumIndex], ir->partition(0));
+            active = true;
+        } else {
+            ::memset(accumulator, 0, sizeof(float) * SpectrumSize);
+        }
 
-        size_t tailIndex = 0;
-        bool irReady = false;
+        // Collect the rest of the partitions, or compute them here
+        // if they have not been scheduled (no worker or just reset).
+        size_t next = 1;
 
-        bool dephase = false;
-        size_t preconvolveIndex = 0;
-        std::atomic<bool> preconvolved = false;
+        for (auto& segment : segments) {
+            if (!segment->scheduled)
+                break;
 
-        Block()
-        {
-            convolutionBuffer = (float*) AlignedMemory<32>::alloc(Length4 * sizeof(float));
-            outputBuffer      = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
-            tailBuffer        = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
-        }
+            if (worker != nullptr)
+                worker->complete(segment.get());
 
-        Block(const Block& other)
-            : worker{other.worker}
-            , inputSpectrumPtr{other.inputSpectrumPtr}
-            , irSpectrumPtr{other.irSpectrumPtr}
-            , preconvolved{false}
-        {
-            convolutionBuffer = (float*) AlignedMemory<32>::alloc(Length4 * sizeof(float));
-            outputBuffer      = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
-            tailBuffer        = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+            if (segment->active) {
+                simd::add(accumulator, segment->accumulator, SpectrumSize);
+                active = true;
+            }
+
+            segment->scheduled = false;
+            next = segment->last;
         }
 
-        ~Block()
-        {
-            AlignedMemory<32>::free(tailBuffer);
-            AlignedMemory<32>::free(outputBuffer);
-            AlignedMemory<32>::free(convolutionBuffer);
+        if (accumulate(accumulator, next, numPartitions, inputSpectrumIndex) > 0)
+            active = true;
+
+        return active;
+    }
+
+    /// Overlap-add the transformed accumulator, and proceed to the next block.
+    void finishBlock()
+    {
+        // Add tail buffer from previous convolution
+        constexpr float norm = 1.0f / Length2;
+
+        for (size_t i = 0; i < Length; ++i) {
+            outputBuffer[i] = norm * (accumulator[i] + tailBuffer[i]);
+            tailBuffer[i] = accumulator[Length + i];
         }
 
-        void reset()
-        {
-            ::memset(convolutionBuffer, 0, sizeof(float) * Length4);
-            ::memset(outputBuffer,      0, sizeof(float) * Length);
-            ::memset(tailBuffer,        0, sizeof(float) * Length);
-            tailIndex = 0;
-            irReady = false;
-
-            dephase = false;
-            preconvolved =false;
+        // Move input spectrum index to the next chunk, which is the oldest one
+        inputSpectrumIndex = inputSpectrumIndex == 0 ? inputSpectrumBufferSize - SpectrumSize
+            : inputSpectrumIndex - SpectrumSize;
+
+        // Start accumulating the partitions for the next block
+        scheduleSegments();
+    }
+
+    void scheduleSegments()
+    {
+        // Nothing to accumulate over a silent history
+        if (worker == nullptr || segments.empty() || numActiveBlocks == 0)
+            return;
+
+        const size_t numSegments = jmin(segments.size(), (size_t) worker->getNumThreads());
+        const size_t numToSplit = numPartitions - 1;
+
+        size_t first = 1;
+
+        for (size_t i = 0; i < numSegments; ++i) {
+            auto& segment = *segments[i];
+
+            segment.first = first;
+            segment.last = 1 + (i + 1) * numToSplit / numSegments;
+            segment.inputSpectrumIndex = inputSpectrumIndex;
+            first = segment.last;
+
+            // The result is needed by the end of the next block.
+            if (!worker->addJob(&segment, int(Length)))
+                segment.run(); // Queue is full
+
+            segment.scheduled = true;
         }
+    }
 
-        void irFft()
-        {
-            assert(irSpectrumPtr != nullptr);
-            FftImpl::fft_real_padded(irSpectrumPtr);
-            irReady = true;
+    /// Drop background jobs, so that the buffers can be safely modified.
+    void cancelJobs()
+    {
+        for (auto& segment : segments) {
+            if (worker != nullptr)
+                worker->cancel(segment.get());
+
+            segment->scheduled = false;
         }
+    }
 
-        void convolve()
-        {
-            // IR is not ready yet - nothig to do
-            if (! irReady)
-                return;
+    //------------------------------------------------------
 
-            if (dephase) {
-                postconvolve();
-                return;
-            }
+    size_t numPartitions;
+    size_t inputIndex;
 
-            preconvolve();
-            postconvolve();
+    float* inputSpectrumBuffer;     ///< Input spectra delay line.
+    size_t inputSpectrumBufferSize;
+    size_t inputSpectrumIndex;      ///< Input block being collected.
 
-            dephase = true;
-        }
+    std::vector<uint8_t> silentBlocks;  ///< Whether each input spectra slot holds a silent block.
+    size_t numActiveBlocks;
 
-        void preconvolve()
-        {
-            assert(inputSpectrumPtr != nullptr);
-            assert(irSpectrumPtr != nullptr);
+    std::shared_ptr<const IR> ir;   ///< Partitions spectra.
+    size_t numIrPartitions;
+
+    float* accumulator;
+    float* outputBuffer;
+    float* tailBuffer;
+
+    Worker* worker;
+    std::vector<std::unique_ptr<Segment>> segments;
+};
+
+//----------------------------------------------------------
+
+/**
+ * @brief Uniformly partitioned convolver running entirely in background.
+ *
+ * Each input block is convolved by a single worker job during the next block,
+ * and the result is output during the block after that, so the output is
+ * delayed by two blocks. This suits the late part of a long IR: large
+ * partitions are cheap per sample, and their transforms do not hit the audio
+ * thread at the block boundary.
+ */
+template <size_t L>
+class BackgroundPartitionedConvolver final
+{
+public:
 
-            if (preconvolved)
-                return; // Already preconvolved or overload?
+    static_assert(math::isPowerOfTwo(L), "Block length must be a power of two");
+
+    constexpr static size_t Length = L;
+    constexpr static size_t Length2 = 2 * Length;
+    constexpr static size_t SpectrumSize = Length2;
+
+    /// Output delay (in number of samples).
+    constexpr static size_t Latency = 2 * Length;
+
+    using FftImpl = GRFFT<Length2>;
 
-            simd::complex_mul_conj(convolutionBuffer, inputSpectrumPtr, irSpectrumPtr, Length4);
+    using IR = PartitionedIR<L>;
 
-            FftImpl::fft(convolutionBuffer);
+    BackgroundPartitionedConvolver(size_t n = 0)
+        : numPartitions{n}
+        , inputIndex{0}
+        , inputBuffer{nullptr}
+        , inputSpectrumBuffer{nullptr}
+        , inputSpectrumBufferSize{SpectrumSize * n}
+        , inputSpectrumIndex{0}
+        , silentBlocks(n, 1)
+        , numActiveBlocks{0}
+        , ir{}
+        , numIrPartitions{0}
+        , worker{nullptr}
+        , job{*this}
+        , scheduled{false}
+    {
+        inputBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+        inputSpectrumBuffer = (float*) AlignedMemory<32>::alloc(inputSpectrumBufferSize * sizeof(float));
+        accumulator = (float*) AlignedMemory<32>::alloc(SpectrumSize * sizeof(float));
+        outputBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+        pendingBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
+        tailBuffer = (float*) AlignedMemory<32>::alloc(Length * sizeof(float));
 
-            preconvolved = true;
+        reset();
+    }
+
+    ~BackgroundPartitionedConvolver()
+    {
+        setWorker(nullptr);
+        AlignedMemory<32>::free(tailBuffer);
+        AlignedMemory<32>::free(pendingBuffer);
+        AlignedMemory<32>::free(outputBuffer);
+        AlignedMemory<32>::free(accumulator);
+        AlignedMemory<32>::free(inputSpectrumBuffer);
+        AlignedMemory<32>::free(inputBuffer);
+    }
+
+    BackgroundPartitionedConvolver(const BackgroundPartitionedConvolver&) = delete;
+    BackgroundPartitionedConvolver& operator = (const BackgroundPartitionedConvolver&) = delete;
+
+    size_t size() const noexcept { return numPartitions; }
+
+    void resize(size_t n)
+    {
+        cancelJob();
+
+        if (n * SpectrumSize != inputSpectrumBufferSize) {
+            AlignedMemory<32>::free(inputSpectrumBuffer);
+            inputSpectrumBufferSize = n * SpectrumSize;
+            inputSpectrumBuffer = (float*) AlignedMemory<32>::alloc(inputSpectrumBufferSize * sizeof(float));
         }
 
-        void postconvolve()
-        {
-            if (! preconvolved)
-                return; // Not ready :(
+        silentBlocks.assign(n, 1);
+
+        numPartitions = n;
+
+        reset();
+    }
 
-            // Add tail buffer from previous convolution
-            size_t tail = 0;
+    void setWorker(Worker* w)
+    {
+        cancelJob();
+        worker = w;
+    }
 
-            for (size_t i = 0; i < Length2; i += 2) {
-                constexpr float norm = 1.0f / Length2;
+    void reset()
+    {
+        cancelJob();
 
-                // Put output samples together without interleaving
-                outputBuffer[tail] = norm * (convolutionBuffer[i] + tailBuffer[tail]);
-                tailBuffer[tail] = convolutionBuffer[Length2 + i];
-                ++tail;
+        inputIndex = 0;
+        ::memset(inputBuffer, 0, sizeof(float) * Length);
+
+        ::memset(inputSpectrumBuffer, 0, sizeof(float) * inputSpectrumBufferSize);
+        inputSpectrumIndex = 0;
+
+        std::fill(silentBlocks.begin(), silentBlocks.end(), 1);
+        numActiveBlocks = 0;
+
+        ::memset(accumulator,   0, sizeof(float) * SpectrumSize);
+        ::memset(outputBuffer,  0, sizeof(float) * Length);
+        ::memset(pendingBuffer, 0, sizeof(float) * Length);
+        ::memset(tailBuffer,    0, sizeof(float) * Length);
+    }
+
+    /**
+     * Set the IR partitions spectra, which may be shared with other convolvers.
+     * The convolver is resized to the number of partitions.
+     */
+    void setIr(std::shared_ptr<const IR> spectra)
+    {
+        resize(spectra != nullptr ? spectra->size() : 0);
+
+        ir = std::move(spectra);
+        numIrPartitions = ir != nullptr ? ir->ready() : 0;
+    }
+
+    /**
+     * Convolve a block of samples of any length,
+     * adding the result to the output.
+     */
+    void processAdd(const float* in, float* out, size_t n)
+    {
+        if (numPartitions == 0)
+            return;
+
+        size_t j = 0;
+
+        while (j < n) {
+            const size_t k = jmin(n - j, Length - inputIndex);
+
+            for (size_t i = 0; i < k; ++i)
+                out[j + i] += outputBuffer[inputIndex + i];
+
+            ::memcpy(&inputBuffer[inputIndex], &in[j], sizeof(float) * k);
+
+            j += k;
+            inputIndex += k;
+
+            if (inputIndex == Length) {
+                inputIndex = 0;
+                nextBlock();
             }
+        }
+    }
+
+private:
+
+    struct Job final : public Worker::Job
+    {
+        BackgroundPartitionedConvolver& owner;
+
+        explicit Job(BackgroundPartitionedConvolver& o) : owner{o} {}
+
+        void run() override { owner.convolve(); }
+    };
 
-            preconvolved = false;
+    void nextBlock()
+    {
+        // Previous block result is due now
+        if (scheduled) {
+            worker->complete(&job);
+            scheduled = false;
         }
 
-        float tick()
-        {
-            float y = outputBuffer[tailIndex];
-            tailIndex = (tailIndex + 1) % Length;
-
-            if (dephase && tailIndex == preconvolveIndex) {
-                if (worker != nullptr)
-                    worker->addJob (this);
-                else
-                    preconvolve();
-            }
+        std::swap(outputBuffer, pendingBuffer);
 
-            return y;
+        // Oldest input spectrum is replaced by the new block
+        inputSpectrumIndex = inputSpectrumIndex == 0 ? inputSpectrumBufferSize - SpectrumSize
+            : inputSpectrumIndex - SpectrumSize;
+
+        ::memcpy(&inputSpectrumBuffer[inputSpectrumIndex], inputBuffer, sizeof(float) * Length);
+        ::memset(&inputSpectrumBuffer[inputSpectrumIndex + Length], 0, sizeof(float) * Length);
+
+        const bool silent = isSilent(inputBuffer, Length);
+        auto& flag = silentBlocks[inputSpectrumIndex / SpectrumSize];
+
+        if (flag && !silent)
+            ++numActiveBlocks;
+        else if (!flag && silent)
+            --numActiveBlocks;
+
+        flag = silent;
+
+        // With a silent history only the tail is left, which is cheap.
+        if (numActiveBlocks > 0 && worker != nullptr && worker->addJob(&job, int(Length)))
+            scheduled = true;
+        else
+            convolve();
+    }
+
+    /**
+     * Convolve the latest input block into the pending output buffer.
+     * Silent input blocks, whose spectra are zero, are skipped.
+     */
+    void convolve()
+    {
+        if (!silentBlocks[inputSpectrumIndex / SpectrumSize])
+            FftImpl::fft(&inputSpectrumBuffer[inputSpectrumIndex]);
+
+        ::memset(accumulator, 0, sizeof(float) * SpectrumSize);
+        size_t count = 0;
+
+        for (size_t i = 0; i < numIrPartitions; ++i) {
+            const size_t slot = (inputSpectrumIndex + i * SpectrumSize) % inputSpectrumBufferSize;
+
+            if (silentBlocks[slot / SpectrumSize] || ir->isZero(i))
+                continue;
+
+            FftImpl::mul_add(accumulator, &inputSpectrumBuffer[slot], ir->partition(i));
+            ++count;
         }
 
-        // Job
-        void run() override
-        {
-            preconvolve();
+        if (count > 0)
+            FftImpl::ifft(accumulator);
+
+        constexpr float norm = 1.0f / Length2;
+
+        for (size_t i = 0; i < Length; ++i) {
+            pendingBuffer[i] = norm * (accumulator[i] + tailBuffer[i]);
+            tailBuffer[i] = accumulator[Length + i];
         }
-    };
+    }
+
+    void cancelJob()
+    {
+        if (worker != nullptr)
+            worker->cancel(&job);
+
+        scheduled = false;
+    }
 
     //------------------------------------------------------
 
+    size_t numPartitions;
     size_t inputIndex;
+    float* inputBuffer;             ///< Input block being collected.
 
-    float* inputSpectrumBuffer;
+    float* inputSpectrumBuffer;     ///< Input spectra delay line.
     size_t inputSpectrumBufferSize;
-    size_t inputSpectrumIndex;
+    size_t inputSpectrumIndex;      ///< Latest complete input block.
+
+    std::vector<uint8_t> silentBlocks;  ///< Whether each input spectra slot holds a silent block.
+    size_t numActiveBlocks;
+
+    std::shared_ptr<const IR> ir;   ///< Partitions spectra.
+    size_t numIrPartitions;
+
+    float* accumulator;
+    float* outputBuffer;            ///< Output of the block before the previous one.
+    float* pendingBuffer;           ///< Output of the previous block, being computed.
+    float* tailBuffer;
+
+    Worker* worker;
+    Job job;
+    bool scheduled;
+};
+
+//----------------------------------------------------------
+
+/**
+ * @brief Pair of uniformly partitioned convolvers sharing the transforms.
+ *
+ * Left and right input blocks are transformed with a single complex FFT,
+ * each channel accumulates its own partitions, and both outputs are
+ * transformed back with a single inverse FFT.
+ *
+ * Convolvers state is not duplicated here, so both channels can be
+ * processed either way (or switched between) at any time.
+ */
+template <size_t L>
+class StereoPartitionedConvolver final
+{
+public:
+
+    using Mono = EquallyPartitionedConvolver<L>;
+    using FftImpl = GStereoFFT<Mono::Length2>;
+
+    StereoPartitionedConvolver(Mono& l, Mono& r)
+        : left{l}
+        , right{r}
+    {
+        scratch = (float*) AlignedMemory<32>::alloc(FftImpl::ScratchSize * sizeof(float));
+    }
+
+    ~StereoPartitionedConvolver()
+    {
+        AlignedMemory<32>::free(scratch);
+    }
+
+    StereoPartitionedConvolver(const StereoPartitionedConvolver&) = delete;
+    StereoPartitionedConvolver& operator = (const StereoPartitionedConvolver&) = delete;
+
+    void process(const float* inL, const float* inR, float* outL, float* outR, size_t n)
+    {
+        assert(left.inputIndex == right.inputIndex);
+
+        size_t j = 0;
+
+        while (j < n) {
+            const size_t k = jmin(n - j, L - left.inputIndex);
+
+            const bool ready = left.exchange(&inL[j], &outL[j], k);
+            right.exchange(&inR[j], &outR[j], k);
+
+            if (ready)
+                inputFft();
+
+            j += k;
+        }
+    }
+
+private:
+
+    void inputFft()
+    {
+        left.clearInputPadding();
+        right.clearInputPadding();
+
+        const bool silentL = left.checkInputBlock();
+        const bool silentR = right.checkInputBlock();
+
+        if (!silentL || !silentR)
+            FftImpl::fft(left.inputBlock(), right.inputBlock(), scratch);
+
+        const bool activeL = left.accumulateSpectrum();
+        const bool activeR = right.accumulateSpectrum();
+
+        if (activeL || activeR)
+            FftImpl::ifft(left.accumulator, right.accumulator, scratch);
+
+        left.finishBlock();
+        right.finishBlock();
+    }
+
+    Mono& left;
+    Mono& right;
+    float* scratch;
+};
+
+//----------------------------------------------------------
+
+/**
+ * @brief Background partitioned convolver running at a fraction of the sample rate.
+ *
+ * The input is low-pass filtered and decimated, convolved at the reduced
+ * rate, and then interpolated back to the full rate. This suits the late part
+ * of a reverb, whose high frequencies have mostly decayed anyway: the cost of
+ * the convolution is divided by the decimation factor, for the price of the
+ * filters and of the content above the filters cutoff.
+ *
+ * Decimation and interpolation use the same windowed-sinc filter,
+ * applied polyphase, so that only the needed outputs are computed.
+ */
+template <size_t L>
+class DecimatedConvolver final
+{
+public:
+
+    using Stage = BackgroundPartitionedConvolver<L>;
+    using IR = PartitionedIR<L>;
+
+    /// Filters half length, per unit of decimation factor.
+    constexpr static size_t FilterHalfLengthPerFactor = 8;
+
+    /// Maximum number of samples processed at once.
+    constexpr static size_t MaxBlockSize = 256;
+
+    explicit DecimatedConvolver(size_t f = 2)
+        : factor{f}
+        , filter(designFilter(f))
+        , phases{}
+        , stage{}
+        , inputRing{}
+        , inputIndex{0}
+        , outputRing{}
+        , outputIndex{0}
+        , phase{0}
+        , decimatedIn{}
+        , decimatedOut{}
+    {
+        assert(factor >= 2);
+
+        // Interpolation phases, with the factor gain compensating for the zero-stuffing
+        const size_t numTaps = (filter.size() - 1) / factor + 1;
+        phases.assign(factor, std::vector<float>(numTaps, 0.0f));
+
+        for (size_t p = 0; p < factor; ++p) {
+            for (size_t j = 0; p + j * factor < filter.size(); ++j)
+                phases[p][j] = float(factor) * filter[p + j * factor];
+        }
+
+        // Rings are doubled so that the history is always contiguous
+        inputRing.assign(2 * filter.size(), 0.0f);
+        outputRing.assign(2 * numTaps, 0.0f);
+    }
+
+    DecimatedConvolver(const DecimatedConvolver&) = delete;
+    DecimatedConvolver& operator = (const DecimatedConvolver&) = delete;
+
+    size_t getFactor() const noexcept { return factor; }
+
+    /// Filter delay (in number of full-rate samples).
+    static size_t filterDelay(size_t f) noexcept { return FilterHalfLengthPerFactor * f; }
+
+    /**
+     * Output delay (in number of full-rate samples): IR sample k fed
+     * at offset q appears at lag k - q + latency.
+     */
+    static size_t latency(size_t f) noexcept { return 2 * filterDelay(f) + Stage::Latency * f; }
+
+    /// Low-pass filter with the cutoff below the decimated Nyquist frequency, unity DC gain.
+    static std::vector<float> designFilter(size_t f)
+    {
+        const size_t d = filterDelay(f);
+        const double cutoff = 0.7 * 0.5 / double(f);   // Transition band ends about at the decimated Nyquist
+        std::vector<float> h(2 * d + 1);
+        double sum = 0.0;
+
+        for (size_t k = 0; k < h.size(); ++k) {
+            const double t = double(k) - double(d);
+            const double x = juce::MathConstants<double>::twoPi * double(k) / double(h.size() - 1);
+            const double window = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2.0 * x);
+            const double sinc = t == 0.0 ? 2.0 * cutoff
+                : std::sin(juce::MathConstants<double>::twoPi * cutoff * t) / (juce::MathConstants<double>::pi * t);
+
+            h[k] = float(sinc * window);
+            sum += h[k];
+        }
 
-    float* irSpectrumBuffer;
-    size_t irSpectrumBufferSize;
-    size_t irInputIndex;
-    size_t irInputBlockIndex;
+        for (auto& x : h)
+            x = float(x / sum);
+
+        return h;
+    }
+
+    /// Number of partitions needed to cover the IR from the offset on.
+    static size_t numPartitions(size_t irLength, size_t offset, size_t f) noexcept
+    {
+        const size_t end = irLength + filterDelay(f);
+        const size_t m = end > offset ? (end - offset - 1) / f + 1 : 0;
+        return (m + L - 1) / L;
+    }
+
+    /**
+     * Feed the decimated IR into the spectra, starting at the full-rate offset.
+     * The IR is low-pass filtered (zero-phase) before decimation.
+     */
+    static void feedIr(IR& spectra, const float* ir, size_t irLength, size_t offset, size_t f)
+    {
+        const auto h = designFilter(f);
+        const size_t d = filterDelay(f);
+        const size_t n = spectra.size() * L;
+
+        for (size_t m = 0; m < n; ++m)
+            spectra.feed(float(f) * lowpass(h, ir, irLength, offset + m * f + d));
+    }
+
+    /// Filtered IR sample, centered at j - d.
+    static float lowpass(const std::vector<float>& h, const float* ir, size_t irLength, size_t j) noexcept
+    {
+        float y = 0.0f;
+
+        for (size_t k = 0; k < h.size(); ++k) {
+            if (j >= k && j - k < irLength)
+                y += h[k] * ir[j - k];
+        }
+
+        return y;
+    }
+
+    void setWorker(Worker* w) { stage.setWorker(w); }
+
+    void setIr(std::shared_ptr<const IR> spectra)
+    {
+        stage.setIr(std::move(spectra));
+        reset();
+    }
+
+    void reset()
+    {
+        stage.reset();
+
+        std::fill(inputRing.begin(), inputRing.end(), 0.0f);
+        std::fill(outputRing.begin(), outputRing.end(), 0.0f);
+        inputIndex = 0;
+        outputIndex = 0;
+        phase = 0;
+    }
+
+    /**
+     * Convolve a block of samples, adding the result to the output.
+     * @note The block must not be longer than MaxBlockSize.
+     */
+    void processAdd(const float* in, float* out, size_t n)
+    {
+        assert(n <= MaxBlockSize);
+
+        const size_t numTaps = filter.size();
+        const size_t numPhaseTaps = phases[0].size();
+        const size_t startPhase = phase;
+
+        // Decimate: an output is due every factor input samples
+        size_t m = 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            inputIndex = inputIndex == 0 ? numTaps - 1 : inputIndex - 1;
+            inputRing[inputIndex] = inputRing[inputIndex + numTaps] = in[i];
+
+            if (++phase == factor) {
+                phase = 0;
+                decimatedIn[m++] = simd::mul_reduce_unaligned(filter.data(), &inputRing[inputIndex], numTaps);
+            }
+        }
+
+        std::fill(decimatedOut, decimatedOut + m, 0.0f);
+        stage.processAdd(decimatedIn, decimatedOut, m);
+
+        // Interpolate, using the decimated outputs up to the current sample
+        phase = startPhase;
+        m = 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            if (++phase == factor) {
+                phase = 0;
+                outputIndex = outputIndex == 0 ? numPhaseTaps - 1 : outputIndex - 1;
+                outputRing[outputIndex] = outputRing[outputIndex + numPhaseTaps] = decimatedOut[m++];
+            }
+
+            // The phase is the number of samples since the latest decimated output
+            out[i] += simd::mul_reduce_unaligned(phases[phase].data(), &outputRing[outputIndex], numPhaseTaps);
+        }
+    }
+
+private:
+
+    size_t factor;
+    std::vector<float> filter;
+    std::vector<std::vector<float>> phases;
+
+    Stage stage;
+
+    std::vector<float> inputRing;   ///< Input history, latest first.
+    size_t inputIndex;
+    std::vector<float> outputRing;  ///< Decimated output history, latest first.
+    size_t outputIndex;
+    size_t phase;                   ///< Input samples since the latest decimated one.
 
-    std::vector<Block> blocks;
+    float decimatedIn[MaxBlockSize];
+    float decimatedOut[MaxBlockSize];
 };
 
 } // namespace dsp
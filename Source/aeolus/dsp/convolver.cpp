@@ -20,6 +20,15 @@
 #include "aeolus/audioparam.h"
 #include "aeolus/dsp/convolve.h"
 #include "aeolus/dsp/convolver.h"
+#include "aeolus/ringbuffer.h"
+#include "aeolus/sema.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
 
 using namespace juce;
 
@@ -42,55 +51,604 @@ static_assert(ConvHead::Length == Convolver::BlockSize, "Header block size is wr
 
 using ConvBlock = dsp::FFT<Convolver::BlockSize>;
 
-struct Convolver::Impl
+// Late IR partitions, processed entirely in background
+constexpr static size_t MediumBlockSize = 4 * Convolver::BlockSize;
+constexpr static size_t LargeBlockSize = 16 * Convolver::BlockSize;
+
+using MediumStage = dsp::BackgroundPartitionedConvolver<MediumBlockSize>;
+using LargeStage = dsp::BackgroundPartitionedConvolver<LargeBlockSize>;
+
+// Hybrid mode tail, processed at a reduced rate
+constexpr static size_t DecimatedBlockSize = 1024;
+using DecimatedStage = dsp::DecimatedConvolver<DecimatedBlockSize>;
+
+/// Crossfade between the full-rate and the decimated parts of the IR (in samples).
+constexpr static size_t HybridCrossfade = Convolver::BlockSize;
+
+/**
+ * @brief Numbers of partitions of the convolution tail stages.
+ *
+ * Each stage is delayed by its own length with respect to the previous one
+ * (a background stage of block size B starts at 2B), so that uniform
+ * partitions fill the gap up to 2 * MediumBlockSize, and medium ones
+ * fill the gap up to 2 * LargeBlockSize.
+ */
+struct PartitionPlan
+{
+    size_t uniform = 0;
+    size_t medium = 0;
+    size_t large = 0;
+
+    /// Relative cost per sample, as transforms plus spectra products.
+    static float stageCost(size_t blockSize, size_t n)
+    {
+        return n == 0 ? 0.0f : 10.0f * std::log2(float(2 * blockSize)) + 6.0f * float(n);
+    }
+
+    float cost() const
+    {
+        return stageCost(Convolver::BlockSize, uniform)
+            + stageCost(MediumBlockSize, medium)
+            + stageCost(LargeBlockSize, large);
+    }
+
+    String toString() const
+    {
+        String s = String((int) uniform) + " x " + String((int) Convolver::BlockSize);
+
+        if (medium > 0)
+            s << " + " << String((int) medium) << " x " << String((int) MediumBlockSize);
+
+        if (large > 0)
+            s << " + " << String((int) large) << " x " << String((int) LargeBlockSize);
+
+        return s;
+    }
+
+    /**
+     * Choose the cheapest partitioning for the IR.
+     * @param maxBlockSize Maximum number of samples processed at once,
+     *        background stages must be much longer than that to be of any use.
+     */
+    static PartitionPlan make(size_t length, size_t maxBlockSize)
+    {
+        constexpr size_t B = Convolver::BlockSize;
+
+        // Tail range to cover, assuming the worst case of delayed reverb.
+        const size_t end = length + B;
+        auto blocks = [](size_t from, size_t to, size_t size) -> size_t {
+            return to > from ? (to - from - 1) / size + 1 : 0;
+        };
+
+        PartitionPlan best;
+        best.uniform = jmax((size_t) 1, blocks(B, end, B));
+
+        if (MediumBlockSize >= 4 * maxBlockSize && end > 2 * MediumBlockSize) {
+            PartitionPlan plan;
+            plan.uniform = blocks(B, 2 * MediumBlockSize, B);
+            plan.medium = blocks(2 * MediumBlockSize, end, MediumBlockSize);
+
+            if (plan.cost() < best.cost())
+                best = plan;
+
+            if (LargeBlockSize >= 4 * maxBlockSize && end > 2 * LargeBlockSize) {
+                plan.medium = blocks(2 * MediumBlockSize, 2 * LargeBlockSize, MediumBlockSize);
+                plan.large = blocks(2 * LargeBlockSize, end, LargeBlockSize);
+
+                if (plan.cost() < best.cost())
+                    best = plan;
+            }
+        }
+
+        return best;
+    }
+};
+
+/**
+ * @brief Split of the IR between the convolution stages.
+ *
+ * In hybrid mode the full-rate stages only cover the IR up to the crossover
+ * (plus a crossfade), and the rest goes to the decimated stage.
+ */
+struct IRLayout
+{
+    size_t length = 0;
+    bool zeroDelay = true;
+    PartitionPlan plan;         ///< Full-rate stages.
+    size_t decimation = 1;      ///< Decimation factor of the tail, 1 if there is none.
+    size_t crossover = 0;       ///< First IR sample of the decimated tail.
+    size_t tailPartitions = 0;
+
+    bool isHybrid() const noexcept { return decimation > 1; }
+
+    /// Output delay of the full-rate stages, which the tail is aligned to.
+    size_t latency() const noexcept { return zeroDelay ? 0 : Convolver::BlockSize; }
+
+    /// Offset of the tail spectra in the IR.
+    size_t tailOffset() const noexcept { return DecimatedStage::latency(decimation) - latency(); }
+
+    /// Relative cost per sample, see PartitionPlan::stageCost().
+    float cost() const
+    {
+        if (!isHybrid())
+            return plan.cost();
+
+        const float filtersCost = 4.0f * float(2 * DecimatedStage::filterDelay(decimation) + 1) / float(decimation);
+
+        return plan.cost()
+            + PartitionPlan::stageCost(DecimatedBlockSize, tailPartitions) / float(decimation)
+            + filtersCost;
+    }
+
+    static IRLayout make(size_t length, bool zeroDelay, size_t maxBlockSize, size_t decimation, size_t crossover)
+    {
+        IRLayout layout;
+        layout.length = length;
+        layout.zeroDelay = zeroDelay;
+
+        if (decimation > 1) {
+            // The tail cannot start before its stage latency, nor overlap the head.
+            const size_t minCrossover = jmax(DecimatedStage::latency(decimation), Convolver::BlockSize);
+            crossover = jmax(crossover, minCrossover);
+            crossover = (crossover + decimation - 1) / decimation * decimation;
+
+            if (crossover + HybridCrossfade < length) {
+                layout.decimation = decimation;
+                layout.crossover = crossover;
+                layout.tailPartitions = DecimatedStage::numPartitions(length, layout.tailOffset(), decimation);
+            }
+        }
+
+        layout.plan = PartitionPlan::make(layout.isHybrid() ? layout.crossover + HybridCrossfade : length, maxBlockSize);
+
+        return layout;
+    }
+
+    String toString() const
+    {
+        if (!isHybrid())
+            return "full rate";
+
+        return String((int) decimation) + "x decimated from " + String((int) crossover) + " samples";
+    }
+};
+
+/**
+ * @brief IR partitions spectra of all the convolution tail stages.
+ */
+struct IRSpectraCache::Spectra
+{
+    IRLayout layout;
+    float tailLoss;     ///< Energy lost by the tail decimation, relative to the tail (dB).
+
+    PartitionedIR<Convolver::BlockSize> uniformL;
+    PartitionedIR<Convolver::BlockSize> uniformR;
+    PartitionedIR<MediumBlockSize> mediumL;
+    PartitionedIR<MediumBlockSize> mediumR;
+    PartitionedIR<LargeBlockSize> largeL;
+    PartitionedIR<LargeBlockSize> largeR;
+    PartitionedIR<DecimatedBlockSize> tailL;
+    PartitionedIR<DecimatedBlockSize> tailR;
+
+    Spectra(const AudioBuffer<float>& ir, const IRLayout& l)
+        : layout{l}
+        , tailLoss{0.0f}
+        , uniformL{l.plan.uniform}
+        , uniformR{l.plan.uniform}
+        , mediumL{l.plan.medium}
+        , mediumR{l.plan.medium}
+        , largeL{l.plan.large}
+        , largeR{l.plan.large}
+        , tailL{l.tailPartitions}
+        , tailR{l.tailPartitions}
+    {
+        if (layout.isHybrid()) {
+            // Split the IR with a crossfade, so that the parts sum up to the original.
+            AudioBuffer<float> head(ir);
+            AudioBuffer<float> tail(ir);
+            crossfade(head, tail);
+
+            feedStages(head);
+
+            tailLoss = measureTailLoss(tail);
+
+            const size_t tailLength = jmin(layout.length, (size_t) tail.getNumSamples());
+            DecimatedStage::feedIr(tailL, tail.getReadPointer(0), tailLength, layout.tailOffset(), layout.decimation);
+            DecimatedStage::feedIr(tailR, tail.getReadPointer(jmin(1, tail.getNumChannels() - 1)), tailLength, layout.tailOffset(), layout.decimation);
+        } else {
+            feedStages(ir);
+        }
+    }
+
+    /// Feed the full-rate stages.
+    void feedStages(const AudioBuffer<float>& ir)
+    {
+        // Stages are aligned to the head, which is delayed
+        // by a block if it is not zero-delay.
+        const size_t latency = layout.latency();
+
+        feed(ir, uniformL, uniformR, Convolver::BlockSize - latency);
+        feed(ir, mediumL, mediumR, MediumStage::Latency - latency);
+        feed(ir, largeL, largeR, LargeStage::Latency - latency);
+    }
+
+    /// Fade the head out and the tail in, with equal-gain sine-squared windows.
+    void crossfade(AudioBuffer<float>& head, AudioBuffer<float>& tail) const
+    {
+        const int numSamples = head.getNumSamples();
+        const int from = jmin((int) layout.crossover, numSamples);
+        const int to = jmin((int) (layout.crossover + HybridCrossfade), numSamples);
+
+        for (int ch = 0; ch < head.getNumChannels(); ++ch) {
+            float* h = head.getWritePointer(ch);
+            float* t = tail.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i) {
+                float g = 0.0f;
+
+                if (i >= to) {
+                    g = 1.0f;
+                } else if (i >= from) {
+                    const float x = std::sin(MathConstants<float>::halfPi * float(i - from) / float(HybridCrossfade));
+                    g = x * x;
+                }
+
+                h[i] *= 1.0f - g;
+                t[i] *= g;
+            }
+        }
+    }
+
+    /// Energy above the decimated band, relative to the tail energy (dB).
+    float measureTailLoss(const AudioBuffer<float>& tail) const
+    {
+        const auto h = DecimatedStage::designFilter(layout.decimation);
+        const size_t d = DecimatedStage::filterDelay(layout.decimation);
+        const size_t numSamples = jmin(layout.length, (size_t) tail.getNumSamples());
+
+        // A sparse estimate is good enough here
+        constexpr size_t stride = 4;
+        double lost = 0.0;
+        double total = 0.0;
+
+        for (int ch = 0; ch < tail.getNumChannels(); ++ch) {
+            const float* t = tail.getReadPointer(ch);
+
+            for (size_t i = layout.crossover; i < numSamples; i += stride) {
+                const float e = t[i] - DecimatedStage::lowpass(h, t, numSamples, i + d);
+                lost += double(e) * double(e);
+                total += double(t[i]) * double(t[i]);
+            }
+        }
+
+        return total > 0.0 ? float(10.0 * std::log10(jmax(lost / total, 1e-12))) : -120.0f;
+    }
+
+    template <size_t L>
+    static void feed(const AudioBuffer<float>& ir, PartitionedIR<L>& left, PartitionedIR<L>& right, size_t offset)
+    {
+        const size_t irLength = (size_t) ir.getNumSamples();
+        const size_t numSamples = left.size() * L;
+
+        left.feed(ir.getReadPointer(0), irLength, offset, numSamples);
+        right.feed(ir.getReadPointer(jmin(1, ir.getNumChannels() - 1)), irLength, offset, numSamples);
+    }
+
+    size_t getMemoryUsage() const
+    {
+        return uniformL.getMemoryUsage() + uniformR.getMemoryUsage()
+            + mediumL.getMemoryUsage() + mediumR.getMemoryUsage()
+            + largeL.getMemoryUsage() + largeR.getMemoryUsage()
+            + tailL.getMemoryUsage() + tailR.getMemoryUsage();
+    }
+};
+
+struct IRSpectraCache::Impl
 {
-    enum State
+    struct Key
     {
-        Idle,
-        Init,
-        FeedHeadIR,
-        ProcessWithIRStream,
-        Process
+        int irId;
+        float sampleRate;
+        size_t length;
+        bool zeroDelay;
+        size_t uniform;
+        size_t medium;
+        size_t large;
+        size_t decimation;
+        size_t crossover;
+
+        bool operator < (const Key& other) const
+        {
+            return std::tie(irId, sampleRate, length, zeroDelay, uniform, medium, large, decimation, crossover)
+                 < std::tie(other.irId, other.sampleRate, other.length, other.zeroDelay, other.uniform, other.medium, other.large,
+                            other.decimation, other.crossover);
+        }
     };
 
-    AudioParameterPool params;
-    Worker worker;
-    size_t length;
+    mutable std::mutex mutex;
+    std::map<Key, std::weak_ptr<const Spectra>> entries;
+};
+
+IRSpectraCache::IRSpectraCache()
+    : d(std::make_unique<Impl>())
+{
+}
+
+IRSpectraCache::~IRSpectraCache() = default;
+
+std::shared_ptr<const IRSpectraCache::Spectra> IRSpectraCache::get(int irId, float sampleRate, const AudioBuffer<float>& ir,
+                                                                   size_t length, bool zeroDelay, size_t maxBlockSize,
+                                                                   size_t decimation, size_t crossover)
+{
+    const auto layout = IRLayout::make(length, zeroDelay, maxBlockSize, decimation, crossover);
+    const auto& plan = layout.plan;
+    const Impl::Key key{irId, sampleRate, length, zeroDelay, plan.uniform, plan.medium, plan.large,
+                        layout.decimation, layout.crossover};
+
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    // Drop the entries no convolver uses anymore
+    for (auto it = d->entries.begin(); it != d->entries.end();) {
+        if (it->second.expired())
+            it = d->entries.erase(it);
+        else
+            ++it;
+    }
+
+    auto& entry = d->entries[key];
+
+    if (auto spectra = entry.lock())
+        return spectra;
+
+    auto spectra = std::make_shared<const Spectra>(ir, layout);
+    entry = spectra;
+
+    return spectra;
+}
+
+size_t IRSpectraCache::getMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    size_t total = 0;
 
-    State state;
+    for (const auto& entry : d->entries) {
+        if (auto spectra = entry.second.lock())
+            total += spectra->getMemoryUsage();
+    }
+
+    return total;
+}
+
+//----------------------------------------------------------
+
+/**
+ * @brief IR-dependent part of the convolver.
+ *
+ * Holds the input history of all the stages, while the IR spectra
+ * of the tail stages may be shared with other convolvers.
+ * A kernel is built off the audio thread, and is owned by the audio thread
+ * once it has been handed over.
+ */
+struct ConvKernel
+{
+    size_t length;
+    bool zeroDelay;
+    std::shared_ptr<const IRSpectraCache::Spectra> spectra;
 
     ConvHead headL;
     ConvHead headR;
-    bool zeroDelay;
 
     dsp::EquallyPartitionedConvolver<Convolver::BlockSize> convL;
     dsp::EquallyPartitionedConvolver<Convolver::BlockSize> convR;
+    dsp::StereoPartitionedConvolver<Convolver::BlockSize> convLR;
+
+    MediumStage mediumL;
+    MediumStage mediumR;
+    LargeStage largeL;
+    LargeStage largeR;
 
-    std::vector<ConvBlock> blocksL;
-    std::vector<ConvBlock> blocksR;
+    // Late tail in hybrid mode
+    std::unique_ptr<DecimatedStage> tailL;
+    std::unique_ptr<DecimatedStage> tailR;
 
     // For zero-delay convolution
     AudioBuffer<float> input;
     AudioBuffer<float> ir;
-    size_t irSamplesRead;
 
-    size_t inputSize;
-    size_t framesProcessed;
+    ConvKernel(const AudioBuffer<float>& irBuffer, std::shared_ptr<const IRSpectraCache::Spectra> s, size_t len, bool zd)
+        : length{len}
+        , zeroDelay{zd}
+        , spectra{std::move(s)}
+        , headL{}
+        , headR{}
+        , convL{}
+        , convR{}
+        , convLR{convL, convR}
+        , mediumL{}
+        , mediumR{}
+        , largeL{}
+        , largeR{}
+        , tailL{}
+        , tailR{}
+        , input(2, ConvHead::Length)
+        , ir(2, ConvHead::Length)
+    {
+        // Stages refer to the spectra, which are kept alive here.
+        convL.setIr({spectra, &spectra->uniformL});
+        convR.setIr({spectra, &spectra->uniformR});
+        mediumL.setIr({spectra, &spectra->mediumL});
+        mediumR.setIr({spectra, &spectra->mediumR});
+        largeL.setIr({spectra, &spectra->largeL});
+        largeR.setIr({spectra, &spectra->largeR});
+
+        if (spectra->layout.isHybrid()) {
+            tailL = std::make_unique<DecimatedStage>(spectra->layout.decimation);
+            tailR = std::make_unique<DecimatedStage>(spectra->layout.decimation);
+            tailL->setIr({spectra, &spectra->tailL});
+            tailR->setIr({spectra, &spectra->tailR});
+        }
+
+        // The head only needs the IR first block
+        input.clear();
+        ir.clear();
+
+        const int headLength = jmin(irBuffer.getNumSamples(), (int) ConvHead::Length);
+
+        for (int ch = 0; ch < 2; ++ch)
+            ir.copyFrom(ch, 0, irBuffer, jmin(ch, irBuffer.getNumChannels() - 1), 0, headLength);
+
+        headL.init(ir.getWritePointer (0), input.getWritePointer (0), Convolver::BlockSize);
+        headR.init(ir.getWritePointer (1), input.getWritePointer (1), Convolver::BlockSize);
+
+        headL.reset();
+        headR.reset();
+    }
+
+    ConvKernel(const ConvKernel&) = delete;
+    ConvKernel& operator = (const ConvKernel&) = delete;
+
+    /**
+     * Attach the background stages to the worker (or detach them with nullptr).
+     * @note Detaching cancels the pending jobs, which may wait for a running one.
+     */
+    void setWorker(Worker* w)
+    {
+        convL.setWorker(w);
+        convR.setWorker(w);
+        mediumL.setWorker(w);
+        mediumR.setWorker(w);
+        largeL.setWorker(w);
+        largeR.setWorker(w);
+
+        if (tailL != nullptr) {
+            tailL->setWorker(w);
+            tailR->setWorker(w);
+        }
+    }
+
+    const IRLayout& layout() const noexcept { return spectra->layout; }
+
+    /**
+     * Produce the wet signal for a chunk.
+     * @param headOutL, headOutR Scratch buffers for the head convolution.
+     */
+    void process(const float *inL, const float *inR, float *wetL, float *wetR,
+                 float *headOutL, float *headOutR, size_t n, bool stereoPacking)
+    {
+        if (stereoPacking) {
+            convLR.process(inL, inR, wetL, wetR, n);
+        } else {
+            convL.process(inL, wetL, n);
+            convR.process(inR, wetR, n);
+        }
+
+        mediumL.processAdd(inL, wetL, n);
+        mediumR.processAdd(inR, wetR, n);
+        largeL.processAdd(inL, wetL, n);
+        largeR.processAdd(inR, wetR, n);
+
+        if (tailL != nullptr) {
+            tailL->processAdd(inL, wetL, n);
+            tailR->processAdd(inR, wetR, n);
+        }
+
+        if (zeroDelay) {
+            headL.process(inL, headOutL, n);
+            headR.process(inR, headOutR, n);
+
+            for (size_t i = 0; i < n; ++i) {
+                wetL[i] += headOutL[i];
+                wetR[i] += headOutR[i];
+            }
+        }
+    }
+};
+
+struct Convolver::Impl
+{
+    /// Number of samples processed at once.
+    constexpr static size_t ChunkSize = 256;
+    static_assert(ChunkSize <= Convolver::BlockSize / 2, "Chunk is too long for the head convolver");
+    static_assert(ChunkSize <= DecimatedStage::MaxBlockSize, "Chunk is too long for the decimated tail");
+
+    /// Length of the crossfade when switching the IR while playing.
+    constexpr static size_t CrossfadeLength = 2 * Convolver::BlockSize;
+
+    struct LoadRequest
+    {
+        const AudioBuffer<float>* ir;
+        int irId;
+        float sampleRate;
+        size_t length;
+        bool zeroDelay;
+        size_t maxBlockSize;
+        size_t decimation;
+        size_t crossover;
+    };
+
+    /// Summary of the current kernel, for reporting.
+    struct KernelInfo
+    {
+        IRLayout layout;
+        float tailLoss = 0.0f;
+    };
+
+    AudioParameterPool params;
+    Worker worker;
+    float sampleRate;
+    size_t length;
+    size_t maxBlockSize;
+    bool zeroDelay;
+    bool stereoPacking;
+    size_t decimation;
+    size_t crossover;
+    KernelInfo info;
+    std::optional<bool> nonRealtime;
+    IRSpectraCache* spectraCache;
+    IRProvider* irProvider;
+
+    std::unique_ptr<ConvKernel> kernel;
+    std::unique_ptr<ConvKernel> fadingKernel;   ///< Previous kernel, being faded out.
+    size_t fadePosition;
+
+    // Kernels are built and destroyed on the loader thread.
+    std::thread loader;
+    LightweightSemaphore loaderSema;
+    std::atomic_bool loaderRunning;
+    RingBuffer<LoadRequest, 8> loadRequests;
+    RingBuffer<ConvKernel*, 8> retiredKernels;
+    std::atomic<ConvKernel*> readyKernel;
+    std::atomic<int> pendingLoads;
+
+    // Wet output of the current and the fading kernels,
+    // and the head scratch for a chunk.
+    AudioBuffer<float> wetBuffer;
 
     Impl ()
         : params{Convolver::NUM_PARAMS}
+        , sampleRate{SAMPLE_RATE_F}
         , length{0}
-        , state{Idle}
-        , headL{}
-        , headR{}
+        , maxBlockSize{ChunkSize}
         , zeroDelay{true}
-        , convL{}
-        , convR{}
-        , input(2, ConvHead::Lenght)
-        , ir(2, ConvHead::Lenght)
-        , irSamplesRead{0}
-        , inputSize{0}
-        , framesProcessed{0}
+        , stereoPacking{DefaultStereoPacking}
+        , decimation{1}
+        , crossover{DefaultHybridCrossover}
+        , info{}
+        , nonRealtime{}
+        , spectraCache{nullptr}
+        , irProvider{nullptr}
+        , kernel{}
+        , fadingKernel{}
+        , fadePosition{0}
+        , loader{}
+        , loaderSema(0)
+        , loaderRunning{true}
+        , loadRequests{}
+        , retiredKernels{}
+        , readyKernel{nullptr}
+        , pendingLoads{0}
+        , wetBuffer(6, (int) ChunkSize)
     {
         params[DRY].setName("dry");
         params[DRY].setValue(DefaultDry, true);
@@ -102,54 +660,108 @@ struct Convolver::Impl
         params[GAIN].setValue(DefaultGain, true);
 
         worker.start();
+        loader = std::thread([this] { runLoader(); });
     }
 
     ~Impl()
     {
+        loaderRunning = false;
+        loaderSema.notify();
+        loader.join();
+
+        delete readyKernel.exchange(nullptr);
+        deleteRetiredKernels();
+
+        fadingKernel.reset();
+        kernel.reset();
+
         worker.stop();
     }
 
-    void init ()
+    void runLoader()
     {
-        size_t numBlocks = length < Convolver::BlockSize ? 1 : (length - 1) / Convolver::BlockSize + 1;
-        inputSize = numBlocks * Convolver::BlockSize;
+        while (loaderRunning) {
+            loaderSema.wait();
 
-        convL.resize(numBlocks);
-        convR.resize(numBlocks);
+            deleteRetiredKernels();
 
-        headL.init(ir.getWritePointer (0), input.getWritePointer (0), Convolver::BlockSize);
-        headR.init(ir.getWritePointer (1), input.getWritePointer (1), Convolver::BlockSize);
+            // Only the most recent request matters
+            LoadRequest request;
+            int numRequests = 0;
+
+            while (loadRequests.receive(request))
+                ++numRequests;
+
+            if (numRequests > 0 && loaderRunning) {
+                std::shared_ptr<const AudioBuffer<float>> waveform;
+                const AudioBuffer<float>* ir = request.ir;
+
+                if (ir == nullptr && irProvider != nullptr) {
+                    waveform = irProvider->getIRWaveform(request.irId, request.sampleRate);
+                    ir = waveform.get();
+                }
 
-        updateRealtime (false);
+                if (ir != nullptr) {
+                    auto* k = makeKernel(*ir, request);
 
-        reset();
+                    // Replace a kernel the audio thread has not picked up yet.
+                    delete readyKernel.exchange(k, std::memory_order_acq_rel);
+                }
+            }
+
+            pendingLoads -= numRequests;
+        }
     }
 
-    void updateRealtime(bool isNonRealtime)
+    /// Load request with the current settings.
+    LoadRequest makeRequest(const AudioBuffer<float>* buffer, int irId) const
     {
-        // Run convolution on a side thread for real-time processing.
-        if (isNonRealtime) {
-            convL.setWorker(nullptr);
-            convR.setWorker(nullptr);
+        return {buffer, irId, sampleRate, length, zeroDelay, maxBlockSize, decimation, crossover};
+    }
+
+    ConvKernel* makeKernel(const AudioBuffer<float>& buffer, const LoadRequest& r)
+    {
+        std::shared_ptr<const IRSpectraCache::Spectra> spectra;
+
+        if (spectraCache != nullptr && r.irId >= 0) {
+            spectra = spectraCache->get(r.irId, r.sampleRate, buffer, r.length, r.zeroDelay, r.maxBlockSize,
+                                        r.decimation, r.crossover);
         } else {
-            convL.setWorker(&worker);
-            convR.setWorker(&worker);
+            const auto layout = IRLayout::make(r.length, r.zeroDelay, r.maxBlockSize, r.decimation, r.crossover);
+            spectra = std::make_shared<const IRSpectraCache::Spectra>(buffer, layout);
         }
+
+        return new ConvKernel(buffer, std::move(spectra), r.length, r.zeroDelay);
     }
 
-    void reset()
+    void deleteRetiredKernels()
     {
-        input.clear();
-        ir.clear();
-        irSamplesRead = 0;
+        ConvKernel* k = nullptr;
 
-        headL.reset();
-        headR.reset();
+        while (retiredKernels.receive(k))
+            delete k;
+    }
 
-        convL.reset();
-        convR.reset();
+    Worker* currentWorker() const
+    {
+        // Run convolution on a side thread for real-time processing.
+        return nonRealtime.value_or(false) ? nullptr : const_cast<Worker*>(&worker);
+    }
 
-        framesProcessed = 0;
+    void updateRealtime(bool isNonRealtime)
+    {
+        // This is called on every processing block,
+        // but detaching the worker cancels its pending jobs.
+        if (nonRealtime && *nonRealtime == isNonRealtime)
+            return;
+
+        nonRealtime = isNonRealtime;
+
+        if (kernel != nullptr)
+            kernel->setWorker(currentWorker());
+
+        if (fadingKernel != nullptr)
+            fadingKernel->setWorker(currentWorker());
     }
 
     void setDryWet(float dry, float wet, bool force)
@@ -164,111 +776,170 @@ struct Convolver::Impl
             || params[WET].value() > 0.0f;
     }
 
-    void setIR(const AudioBuffer<float>& buffer)
+    void setIR(const AudioBuffer<float>& buffer, int irId)
     {
-        ir = buffer;
+        // A kernel still being loaded would be stale.
+        delete readyKernel.exchange(nullptr);
 
-        // Reset the convolver to the initial state
-        irSamplesRead = 0;
-        framesProcessed = 0;
-        input.clear();
+        fadingKernel.reset();
+        kernel.reset(makeKernel(buffer, makeRequest(&buffer, irId)));
+        kernel->setWorker(currentWorker());
+        updateInfo();
+    }
 
-        headL.init(ir.getWritePointer (0), input.getWritePointer (0), Convolver::BlockSize);
-        headR.init(ir.getWritePointer (1), input.getWritePointer (1), Convolver::BlockSize);
+    /// Queue the kernel build, ir may be nullptr to use the IR provider.
+    bool loadIR(const AudioBuffer<float>* buffer, int irId)
+    {
+        if (!loadRequests.send(makeRequest(buffer, irId)))
+            return false;
 
-        headL.reset();
-        headR.reset();
+        ++pendingLoads;
+        loaderSema.notify();
 
-        convL.reset();
-        convR.reset();
+        return true;
+    }
 
-        int i = zeroDelay ? Convolver::BlockSize : 0;
-        const float* irL = ir.getReadPointer(0);
-        const float* irR = ir.getReadPointer(1);
+    bool isLoadingIR() const
+    {
+        return pendingLoads > 0 || readyKernel.load() != nullptr;
+    }
 
-        while (i < jmin ((int)inputSize, ir.getNumSamples())) {
-            convL.feedIr(irL[i]);
-            convR.feedIr(irR[i]);
-            ++i;
-        }
+    void prepareToPlay ()
+    {
+        // Kernels are sized for the previous block size.
+        fadingKernel.reset();
+        kernel.reset();
+        info = {};
+        nonRealtime.reset();
+    }
 
-        while (i < inputSize) {
-            convL.feedIr(0.0f);
-            convR.feedIr(0.0f);
-            ++i;
-        }
+    /// Take over the kernel built by the loader, if any.
+    void adoptReadyKernel()
+    {
+        // Wait for the ongoing crossfade to finish first.
+        if (fadingKernel != nullptr || readyKernel.load(std::memory_order_relaxed) == nullptr)
+            return;
 
-        state = Process;
+        ConvKernel* k = readyKernel.exchange(nullptr, std::memory_order_acq_rel);
+
+        if (k == nullptr)
+            return;
+
+        k->setWorker(currentWorker());
+
+        fadingKernel = std::move(kernel);
+        fadePosition = 0;
+        kernel.reset(k);
+        updateInfo();
     }
 
-    void prepareToPlay ()
+    void updateInfo()
     {
-        state = Init;
-        init();
+        info.layout = kernel->layout();
+        info.tailLoss = kernel->spectra->tailLoss;
     }
 
-    void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
+    String getHybridReport() const
     {
-        if (state == Init)
-            state = zeroDelay ? FeedHeadIR : ProcessWithIRStream;
+        const auto& layout = info.layout;
 
-        if (state == FeedHeadIR)
-        {
-            // ir buffer is ready at this point
-            if (ir.getNumSamples() <= Convolver::BlockSize) {
-                irSamplesRead = ir.getNumSamples();
-                state = Process;
-            } else {
-                irSamplesRead = Convolver::BlockSize;
-                state = ProcessWithIRStream;
-            }
-        }
+        if (!layout.isHybrid())
+            return layout.toString();
 
-        if (state == ProcessWithIRStream) {
-            processFrame(inL, inR, outL, outR, numFrames);
+        const float fullRateCost = PartitionPlan::make(layout.length, maxBlockSize).cost();
+        const int costPercent = roundToInt(100.0f * layout.cost() / jmax(fullRateCost, 1.0f));
 
-            framesProcessed += numFrames;
-
-            if (framesProcessed >= inputSize || irSamplesRead >= ir.getNumSamples()) {
-                // The entire IR has been read, switch to procesing without IR streaming
-                state = Process;
-            }
+        return layout.toString()
+            + ", cost " + String(costPercent) + "% of full rate"
+            + ", tail loss " + String(info.tailLoss, 1) + " dB";
+    }
 
-            return;
+    void retireFadingKernel()
+    {
+        // Detaching from the worker is left to the loader thread,
+        // as it may have to wait for a running job.
+        if (retiredKernels.send(fadingKernel.get())) {
+            fadingKernel.release();
+            loaderSema.notify();
         }
+    }
 
-        if (state == Process) {
-            processFrame(inL, inR, outL, outR, numFrames);
+    void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
+    {
+        worker.advance((int) numFrames);
 
-            return;
+        adoptReadyKernel();
+
+        for (size_t offset = 0; offset < numFrames; offset += ChunkSize) {
+            const size_t n = jmin(ChunkSize, numFrames - offset);
+            processChunk(&inL[offset], &inR[offset], &outL[offset], &outR[offset], n);
         }
     }
 
-    void processFrame(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames)
+    void processChunk(const float *inL, const float *inR, float *outL, float *outR, size_t n)
     {
-        if (zeroDelay) {
-            for (size_t i = 0; i < numFrames; ++i) {
-                const float l = convL.tick(inL[i]) + headL.tick(inL[i]);
-                const float r = convR.tick(inR[i]) + headR.tick(inR[i]);
-
-                const float dry = params[Convolver::DRY].nextValue();
-                const float wet = params[Convolver::WET].nextValue();
+        float* wetL = wetBuffer.getWritePointer(0);
+        float* wetR = wetBuffer.getWritePointer(1);
+        float* headOutL = wetBuffer.getWritePointer(2);
+        float* headOutR = wetBuffer.getWritePointer(3);
 
-                outL[i] = l * wet + inL[i] * dry;
-                outR[i] = r * wet + inR[i] * dry;
-            }
+        if (kernel != nullptr) {
+            kernel->process(inL, inR, wetL, wetR, headOutL, headOutR, n, stereoPacking);
         } else {
-            for (size_t i = 0; i < numFrames; ++i) {
-                const float l = convL.tick(inL[i]);
-                const float r = convR.tick(inR[i]);
+            ::memset(wetL, 0, sizeof(float) * n);
+            ::memset(wetR, 0, sizeof(float) * n);
+        }
 
-                const float dry = params[Convolver::DRY].nextValue();
-                const float wet = params[Convolver::WET].nextValue();
+        if (fadingKernel != nullptr) {
+            float* fadeL = wetBuffer.getWritePointer(4);
+            float* fadeR = wetBuffer.getWritePointer(5);
 
-                outL[i] = l * wet + inL[i] * dry;
-                outR[i] = r * wet + inR[i] * dry;
-            }
+            fadingKernel->process(inL, inR, fadeL, fadeR, headOutL, headOutR, n, stereoPacking);
+            crossfade(wetL, wetR, fadeL, fadeR, n);
+        }
+
+        // Dry/wet smoothing as linear ramps over the chunk
+        const auto dry = params[Convolver::DRY].nextRamp((int) n);
+        const auto wet = params[Convolver::WET].nextRamp((int) n);
+
+        // Output may be the same buffer as input
+        if (outL != inL)
+            ::memcpy(outL, inL, sizeof(float) * n);
+
+        if (outR != inR)
+            ::memcpy(outR, inR, sizeof(float) * n);
+
+        simd::mul_ramp(outL, dry.start, dry.step, n);
+        simd::mul_ramp(outR, dry.start, dry.step, n);
+        simd::mul_ramp_add(outL, wetL, wet.start, wet.step, n);
+        simd::mul_ramp_add(outR, wetR, wet.start, wet.step, n);
+    }
+
+    /// Mix the fading kernel output into the wet signal.
+    void crossfade(float* wetL, float* wetR, const float* fadeL, const float* fadeR, size_t n)
+    {
+        // Equal-power gains, as the two reverbs are uncorrelated.
+        // These are interpolated linearly over the chunk.
+        constexpr float halfPi = MathConstants<float>::halfPi;
+        const float x0 = float(fadePosition) / float(CrossfadeLength);
+        fadePosition = jmin(fadePosition + n, CrossfadeLength);
+        const float x1 = float(fadePosition) / float(CrossfadeLength);
+
+        float gIn = std::sin(halfPi * x0);
+        float gOut = std::cos(halfPi * x0);
+        const float gInStep = (std::sin(halfPi * x1) - gIn) / float(n);
+        const float gOutStep = (std::cos(halfPi * x1) - gOut) / float(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            gIn += gInStep;
+            gOut += gOutStep;
+
+            wetL[i] = wetL[i] * gIn + fadeL[i] * gOut;
+            wetR[i] = wetR[i] * gIn + fadeR[i] * gOut;
         }
+
+        if (fadePosition >= CrossfadeLength)
+            retireFadingKernel();
     }
 };
 
@@ -281,9 +952,35 @@ Convolver::Convolver()
 
 Convolver::~Convolver() = default;
 
-void Convolver::setIR(const AudioBuffer<float>& ir)
+void Convolver::setIR(const AudioBuffer<float>& ir, int irId)
 {
-    d->setIR(ir);
+    d->setIR(ir, irId);
+}
+
+bool Convolver::loadIR(const AudioBuffer<float>& ir, int irId)
+{
+    return d->loadIR(&ir, irId);
+}
+
+bool Convolver::loadIR(int irId)
+{
+    jassert(d->irProvider != nullptr);
+    return d->loadIR(nullptr, irId);
+}
+
+void Convolver::setIRProvider(IRProvider* provider) noexcept
+{
+    d->irProvider = provider;
+}
+
+void Convolver::setSpectraCache(IRSpectraCache* cache) noexcept
+{
+    d->spectraCache = cache;
+}
+
+bool Convolver::isLoadingIR() const noexcept
+{
+    return d->isLoadingIR();
 }
 
 void Convolver::setDryWet(float dry, float wet, bool force)
@@ -296,8 +993,10 @@ bool Convolver::isAudible() const
     return d->isAudible();
 }
 
-void Convolver::prepareToPlay(float /* sampleRate */, size_t /* nFrames */)
+void Convolver::prepareToPlay(float sampleRate, size_t nFrames)
 {
+    d->sampleRate = sampleRate;
+    d->maxBlockSize = jmax(nFrames, Impl::ChunkSize);
     d->prepareToPlay();
 }
 
@@ -321,6 +1020,43 @@ void Convolver::setLength(int len) noexcept
     d->length = len;
 }
 
+String Convolver::getPartitionPlan() const
+{
+    return d->info.layout.plan.toString();
+}
+
+void Convolver::setHybrid(int decimation, int crossover) noexcept
+{
+    jassert(decimation >= 1 && crossover >= 0);
+    d->decimation = (size_t) jmax(1, decimation);
+    d->crossover = (size_t) jmax(0, crossover);
+}
+
+int Convolver::hybridDecimation() const noexcept
+{
+    return (int) d->decimation;
+}
+
+int Convolver::hybridCrossover() const noexcept
+{
+    return (int) d->crossover;
+}
+
+String Convolver::getHybridReport() const
+{
+    return d->getHybridReport();
+}
+
+bool Convolver::stereoPacking() const noexcept
+{
+    return d->stereoPacking;
+}
+
+void Convolver::setStereoPacking(bool v) noexcept
+{
+    d->stereoPacking = v;
+}
+
 bool Convolver::zeroDelay() const noexcept
 {
     return d->zeroDelay;
@@ -331,6 +1067,26 @@ void Convolver::setZeroDelay(bool v) noexcept
     d->zeroDelay = v;
 }
 
+Worker::Stats Convolver::getWorkerStats() const noexcept
+{
+    return d->worker.getStats();
+}
+
+void Convolver::setWorkerThreadsCount(int numThreads)
+{
+    d->worker.setNumThreads(numThreads);
+}
+
+void Convolver::setWorkerThreadPolicy(const ThreadPolicy& policy)
+{
+    d->worker.setThreadPolicy(policy);
+}
+
+String Convolver::getWorkerThreadPolicy() const
+{
+    return String(d->worker.getNumThreads()) + " x " + d->worker.getAppliedThreadPolicy();
+}
+
 } // namespace dsp
 
 AEOLUS_NAMESPACE_END
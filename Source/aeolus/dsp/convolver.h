@@ -20,12 +20,68 @@
 #pragma once
 
 #include "aeolus/globals.h"
+#include "aeolus/worker.h"
 #include <memory>
 
 AEOLUS_NAMESPACE_BEGIN
 
 namespace dsp {
 
+/**
+ * @brief Cache of the IR partitions spectra, shared between convolvers.
+ *
+ * The spectra only depend on the IR and on its partitioning, so all the
+ * convolvers rendering the same IR can use a single read-only copy.
+ * Entries are held weakly, and are released along with the last
+ * convolver using them.
+ */
+class IRSpectraCache final
+{
+public:
+
+    struct Spectra;
+
+    IRSpectraCache();
+    ~IRSpectraCache();
+
+    /**
+     * Get the spectra of the IR, computing them if they are not cached.
+     * @param irId, sampleRate IR identifier and rate, the same pair must refer to the same waveform.
+     * @param decimation, crossover Hybrid mode settings, see Convolver::setHybrid().
+     */
+    std::shared_ptr<const Spectra> get(int irId, float sampleRate, const juce::AudioBuffer<float>& ir,
+                                       size_t length, bool zeroDelay, size_t maxBlockSize,
+                                       size_t decimation = 1, size_t crossover = 0);
+
+    /// Memory taken by the spectra currently in use (in bytes).
+    size_t getMemoryUsage() const;
+
+private:
+
+    struct Impl;
+    std::unique_ptr<Impl> d;
+};
+
+//----------------------------------------------------------
+
+/**
+ * @brief Source of the IR waveforms loaded by identifier.
+ */
+class IRProvider
+{
+public:
+    virtual ~IRProvider() = default;
+
+    /**
+     * Return the IR waveform at the sample rate, decoding and resampling
+     * it if needed (nullptr if unknown).
+     * This is called on the convolver background thread.
+     */
+    virtual std::shared_ptr<const juce::AudioBuffer<float>> getIRWaveform(int irId, float sampleRate) = 0;
+};
+
+//----------------------------------------------------------
+
 /**
  * @brief Stereo convolution reverb.
  */
@@ -46,6 +102,8 @@ public:
     constexpr static float DefaultDry  = 0.0f;
     constexpr static float DefaultWet  = 1.0f;
     constexpr static float DefaultGain = 1.0f;
+    constexpr static bool DefaultStereoPacking = false;
+    constexpr static int DefaultHybridCrossover = 16384;
 
     /// Single convolution block size (in number of samples).
     constexpr static size_t BlockSize = 4096;
@@ -53,11 +111,50 @@ public:
     Convolver();
     ~Convolver();
 
-    void setIR(const juce::AudioBuffer<float>& ir);
+    /**
+     * Set the IR immediately, using current length and zero-delay settings.
+     * @param irId IR identifier for the spectra cache, -1 not to use the cache.
+     * @note This is not real-time safe, as the IR spectra are computed here.
+     */
+    void setIR(const juce::AudioBuffer<float>& ir, int irId = -1);
+
+    /**
+     * Switch the IR without blocking the audio thread.
+     *
+     * The IR spectra are computed on a background thread, and the new IR
+     * is then crossfaded in by process(). The ir buffer must remain valid
+     * until it has been loaded.
+     *
+     * @return false if the request could not be queued.
+     */
+    bool loadIR(const juce::AudioBuffer<float>& ir, int irId = -1);
+
+    /**
+     * Switch the IR without blocking the audio thread, like above,
+     * with the waveform obtained from the IR provider.
+     */
+    bool loadIR(int irId);
+
+    /// Set the provider of the IRs loaded by identifier (must outlive the convolver).
+    void setIRProvider(IRProvider* provider) noexcept;
+
+    /// Whether an IR requested by loadIR() has not been switched to yet.
+    bool isLoadingIR() const noexcept;
+
+    /**
+     * Share the IR spectra via the cache (nullptr to compute them privately).
+     * The cache must outlive the convolver.
+     */
+    void setSpectraCache(IRSpectraCache* cache) noexcept;
 
     void setDryWet(float dry, float wet, bool force = false);
     bool isAudible() const;
 
+    /**
+     * @param sampleRate Rate the IRs loaded by identifier are requested at.
+     * @param nFrames Maximum number of frames to be processed at once.
+     * @note This drops the current IR, which has to be set again.
+     */
     void prepareToPlay(float sampleRate, size_t nFrames);
 
     void process(const float *inL, const float *inR, float *outL, float *outR, size_t numFrames);
@@ -67,9 +164,53 @@ public:
     int length() const noexcept;
     void setLength(int len) noexcept;
 
+    /// Partitioning of the convolution tail, chosen from the IR length.
+    juce::String getPartitionPlan() const;
+
+    /**
+     * Hybrid mode convolves the IR at full rate up to the crossover only,
+     * and the late tail at the sample rate divided by the decimation factor.
+     * This trades the tail high frequencies (mostly decayed in a hall)
+     * for a much cheaper convolution of long IRs.
+     *
+     * @param decimation Tail decimation factor, 1 to disable the hybrid mode.
+     * @param crossover Tail start (in number of samples), which may be rounded up.
+     * @note This applies to the IRs set or loaded afterwards.
+     */
+    void setHybrid(int decimation, int crossover = DefaultHybridCrossover) noexcept;
+    int hybridDecimation() const noexcept;
+    int hybridCrossover() const noexcept;
+
+    /// Hybrid split of the current IR, with its cost and quality estimates.
+    juce::String getHybridReport() const;
+
+    /**
+     * Stereo packing transforms left and right channels of the
+     * partitioned convolution together, as a single complex signal.
+     * It is off by default: with the real-input FFT it does not run
+     * measurably faster (see the stereopacking benchmark).
+     */
+    bool stereoPacking() const noexcept;
+    void setStereoPacking(bool v) noexcept;
+
     bool zeroDelay() const noexcept;
     void setZeroDelay(bool v) noexcept;
 
+    /// Background convolution jobs scheduling statistics.
+    Worker::Stats getWorkerStats() const noexcept;
+
+    /**
+     * Set the number of background convolution threads (0 for automatic).
+     * @note Changing the number of threads restarts the worker.
+     */
+    void setWorkerThreadsCount(int numThreads);
+
+    /// Set the scheduling policy of the background convolution threads.
+    void setWorkerThreadPolicy(const ThreadPolicy& policy);
+
+    /// Scheduling policy actually applied to the background threads.
+    juce::String getWorkerThreadPolicy() const;
+
 protected:
 
     struct Impl;
@@ -69,6 +69,65 @@ float DelayLine::readNearest(int delay) const
     return _buffer[index];
 }
 
+//==============================================================================
+
+ModulatedDelay::ModulatedDelay(size_t maxDelay)
+    : _buffers{}
+    , _maxDelay{0}
+{
+    resize(maxDelay);
+}
+
+void ModulatedDelay::resize(size_t maxDelay)
+{
+    _maxDelay = juce::jmax((size_t)1, maxDelay);
+
+    for (auto& buffer : _buffers)
+        buffer.resize(_maxDelay + SUB_FRAME_LENGTH);
+
+    reset();
+}
+
+void ModulatedDelay::reset()
+{
+    for (auto& buffer : _buffers)
+        ::memset(buffer.data(), 0, sizeof(float) * buffer.size());
+}
+
+void ModulatedDelay::process(float* left, float* right, const float* delays, int numFrames)
+{
+    for (int offset = 0; offset < numFrames; offset += SUB_FRAME_LENGTH) {
+        float* out[] = { left + offset, right + offset };
+        processBlock(out, delays + offset, juce::jmin(SUB_FRAME_LENGTH, numFrames - offset));
+    }
+}
+
+void ModulatedDelay::processBlock(float* const* out, const float* delays, int numFrames)
+{
+    // Read positions, relative to the block start.
+    int index[SUB_FRAME_LENGTH];
+    float frac[SUB_FRAME_LENGTH];
+
+    const float maxDelay = float(_maxDelay - 1);
+
+    for (int i = 0; i < numFrames; ++i) {
+        const float d = juce::jlimit(0.0f, maxDelay, delays[i]);
+        const int n = (int)d;
+        index[i] = (int)_maxDelay + i - n;
+        frac[i] = d - (float)n;
+    }
+
+    for (size_t ch = 0; ch < _buffers.size(); ++ch) {
+        float* buffer = _buffers[ch].data();
+        ::memcpy(buffer + _maxDelay, out[ch], sizeof(float) * (size_t)numFrames);
+
+        for (int i = 0; i < numFrames; ++i)
+            out[ch][i] = math::lerp(buffer[index[i]], buffer[index[i] - 1], frac[i]);
+
+        ::memmove(buffer, buffer + numFrames, sizeof(float) * _maxDelay);
+    }
+}
+
 } // namespace dsp
 
 AEOLUS_NAMESPACE_END
@@ -21,6 +21,7 @@
 
 #include "aeolus/globals.h"
 
+#include <array>
 #include <vector>
 
 AEOLUS_NAMESPACE_BEGIN
@@ -48,6 +49,37 @@ private:
     size_t _writeIndex;
 };
 
+/**
+ * @brief Stereo delay modulated per sample, processed by blocks.
+ *
+ * The recent input is kept contiguous in front of the block, so that
+ * the delayed samples are read without wrapping around, and the
+ * interpolated positions are computed once for both channels.
+ */
+class ModulatedDelay
+{
+public:
+
+    ModulatedDelay(size_t maxDelay = 32);
+
+    /// Set the longest delay (in samples), this allocates.
+    void resize(size_t maxDelay);
+    void reset();
+
+    /**
+     * Delay a stereo block in place.
+     * @param delays Delay of each sample, from 0 to the longest delay (excluded).
+     */
+    void process(float* left, float* right, const float* delays, int numFrames);
+
+private:
+
+    void processBlock(float* const* out, const float* delays, int numFrames);
+
+    std::array<std::vector<float>, 2> _buffers; ///< Recent input followed by the block, per channel.
+    size_t _maxDelay;
+};
+
 
 } // namespace dsp
 
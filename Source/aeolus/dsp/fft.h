@@ -323,6 +323,221 @@ struct GFFT
     }
 };
 
+/**
+ * @brief FFT of a real signal.
+ *
+ * N real samples are transformed as N/2 complex ones
+ * (even samples as real and odd samples as imaginary parts),
+ * and the spectrum is then separated with post-twiddling.
+ *
+ * Spectrum is packed into N floats: [R0 RN/2 R1 I1 R2 I2 ...],
+ * i.e. the DC and Nyquist bins, which are both real,
+ * share the first complex value.
+ */
+template<unsigned N, typename T = float>
+struct GRFFT
+{
+    static_assert(N >= 4, "Real FFT must be at least 4 samples long");
+
+    constexpr static unsigned M = N / 2;
+
+    using Complex = GFFT<M, T>;
+
+    /// W^k = exp(-2*pi*i*k/N), k < N/2
+    inline static std::array<T, N> w alignas(32) = []() {
+        std::array<T, N> w;
+
+        for (unsigned k = 0; k < M; ++k) {
+            const double phi = juce::MathConstants<double>::twoPi * double(k) / double(N);
+            w[2 * k] = T(std::cos(phi));
+            w[2 * k + 1] = T(-std::sin(phi));
+        }
+
+        return w;
+    }();
+
+    // Data format: [RRRR...] -> packed spectrum
+    static void fft(T* data)
+    {
+        Complex::fft(data);
+
+        const T zr = data[0];
+        const T zi = data[1];
+        data[0] = zr + zi;
+        data[1] = zr - zi;
+
+        for (unsigned k = 1; k <= M / 2; ++k) {
+            const unsigned j = M - k;
+
+            const T ar = data[2 * k];
+            const T ai = data[2 * k + 1];
+            const T br = data[2 * j];
+            const T bi = data[2 * j + 1];
+
+            // Spectra of the even and odd samples
+            const T er = T(0.5) * (ar + br);
+            const T ei = T(0.5) * (ai - bi);
+            const T or_ = T(0.5) * (ai + bi);
+            const T oi = T(0.5) * (br - ar);
+
+            const T wr = w[2 * k];
+            const T wi = w[2 * k + 1];
+            const T tr = wr * or_ - wi * oi;
+            const T ti = wr * oi + wi * or_;
+
+            data[2 * k] = er + tr;
+            data[2 * k + 1] = ei + ti;
+            data[2 * j] = er - tr;
+            data[2 * j + 1] = ti - ei;
+        }
+    }
+
+    // Packed spectrum -> [RRRR...], scaled by N
+    static void ifft(T* data)
+    {
+        const T dc = data[0];
+        const T ny = data[1];
+
+        // Conjugated spectrum is computed, so that the forward
+        // complex transform can be used.
+        data[0] = dc + ny;
+        data[1] = ny - dc;
+
+        for (unsigned k = 1; k <= M / 2; ++k) {
+            const unsigned j = M - k;
+
+            const T ar = data[2 * k];
+            const T ai = data[2 * k + 1];
+            const T br = data[2 * j];
+            const T bi = data[2 * j + 1];
+
+            const T er = ar + br;
+            const T ei = ai - bi;
+            const T dr = ar - br;
+            const T di = ai + bi;
+
+            // Multiply by conj(W^k)
+            const T wr = w[2 * k];
+            const T wi = w[2 * k + 1];
+            const T or_ = dr * wr + di * wi;
+            const T oi = di * wr - dr * wi;
+
+            data[2 * k] = er - oi;
+            data[2 * k + 1] = -(ei + or_);
+            data[2 * j] = er + oi;
+            data[2 * j + 1] = ei - or_;
+        }
+
+        Complex::fft(data);
+
+        for (unsigned i = 1; i < N; i += 2)
+            data[i] = -data[i];
+    }
+
+    /// Multiply packed spectra, res = a * b
+    static void mul(T* res, const T* a, const T* b)
+    {
+        const T dc = a[0] * b[0];
+        const T ny = a[1] * b[1];
+
+        simd::complex_mul(res, a, b, N);
+
+        res[0] = dc;
+        res[1] = ny;
+    }
+
+    /// Multiply and accumulate packed spectra, res += a * b
+    static void mul_add(T* res, const T* a, const T* b)
+    {
+        const T dc = res[0] + a[0] * b[0];
+        const T ny = res[1] + a[1] * b[1];
+
+        simd::complex_mul_add(res, a, b, N);
+
+        res[0] = dc;
+        res[1] = ny;
+    }
+};
+
+/**
+ * @brief FFT of two real signals at once.
+ *
+ * Left and right signals are transformed as the real and the imaginary
+ * parts of a single complex signal of N samples, and the two spectra
+ * are separated afterwards.
+ *
+ * Spectra are packed the same way as with GRFFT.
+ */
+template<unsigned N, typename T = float>
+struct GStereoFFT
+{
+    using Complex = GFFT<N, T>;
+
+    /// Size of the scratch buffer (in number of values).
+    constexpr static unsigned ScratchSize = 2 * N;
+
+    // [RRRR...], [RRRR...] -> packed spectra, in place
+    static void fft(T* left, T* right, T* scratch)
+    {
+        for (unsigned i = 0; i < N; ++i) {
+            scratch[2 * i] = left[i];
+            scratch[2 * i + 1] = right[i];
+        }
+
+        Complex::fft(scratch);
+
+        left[0] = scratch[0];
+        right[0] = scratch[1];
+        left[1] = scratch[N];
+        right[1] = scratch[N + 1];
+
+        for (unsigned k = 1; k < N / 2; ++k) {
+            const unsigned j = N - k;
+
+            const T ar = scratch[2 * k];
+            const T ai = scratch[2 * k + 1];
+            const T br = scratch[2 * j];
+            const T bi = scratch[2 * j + 1];
+
+            left[2 * k] = T(0.5) * (ar + br);
+            left[2 * k + 1] = T(0.5) * (ai - bi);
+            right[2 * k] = T(0.5) * (ai + bi);
+            right[2 * k + 1] = T(0.5) * (br - ar);
+        }
+    }
+
+    // Packed spectra -> [RRRR...], [RRRR...], scaled by N
+    static void ifft(T* left, T* right, T* scratch)
+    {
+        // Conjugated spectrum of left + i * right
+        scratch[0] = left[0];
+        scratch[1] = -right[0];
+        scratch[N] = left[1];
+        scratch[N + 1] = -right[1];
+
+        for (unsigned k = 1; k < N / 2; ++k) {
+            const unsigned j = N - k;
+
+            const T lr = left[2 * k];
+            const T li = left[2 * k + 1];
+            const T rr = right[2 * k];
+            const T ri = right[2 * k + 1];
+
+            scratch[2 * k] = lr - ri;
+            scratch[2 * k + 1] = -(li + rr);
+            scratch[2 * j] = lr + ri;
+            scratch[2 * j + 1] = li - rr;
+        }
+
+        Complex::fft(scratch);
+
+        for (unsigned i = 0; i < N; ++i) {
+            left[i] = scratch[2 * i];
+            right[i] = -scratch[2 * i + 1];
+        }
+    }
+};
+
 } // namespace dsp
 
 AEOLUS_NAMESPACE_END
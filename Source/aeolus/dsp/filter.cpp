@@ -18,6 +18,7 @@
 // ----------------------------------------------------------------------------
 
 #include "aeolus/dsp/filter.h"
+#include "aeolus/simd.h"
 
 AEOLUS_NAMESPACE_BEGIN
 
@@ -171,6 +172,85 @@ void BiquadFilter::process(const Spec& spec, State& state, const float* in, floa
     }
 }
 
+void BiquadFilter::processStereo(const Spec& spec, State& stateL, State& stateR, float* left, float* right, size_t size)
+{
+    const float b0 = spec.b[0];
+    const float b1 = spec.b[1];
+    const float b2 = spec.b[2];
+    const float a1 = spec.a[1];
+    const float a2 = spec.a[2];
+
+    float xl0 = stateL.x[0], xl1 = stateL.x[1], yl0 = stateL.y[0], yl1 = stateL.y[1];
+    float xr0 = stateR.x[0], xr1 = stateR.x[1], yr0 = stateR.y[0], yr1 = stateR.y[1];
+
+    for (size_t i = 0; i < size; ++i) {
+        const float xl = left[i];
+        const float xr = right[i];
+        const float yl = b0 * xl + b1 * xl0 + b2 * xl1 - a1 * yl0 - a2 * yl1;
+        const float yr = b0 * xr + b1 * xr0 + b2 * xr1 - a1 * yr0 - a2 * yr1;
+
+        xl1 = xl0;
+        xl0 = xl;
+        yl1 = yl0;
+        yl0 = yl;
+
+        xr1 = xr0;
+        xr0 = xr;
+        yr1 = yr0;
+        yr0 = yr;
+
+        left[i] = yl;
+        right[i] = yr;
+    }
+
+    stateL = { { xl0, xl1 }, { yl0, yl1 } };
+    stateR = { { xr0, xr1 }, { yr0, yr1 } };
+}
+
+//==============================================================================
+
+static_assert(BiquadBank::NumLanes == 8, "The bank is processed with simd::biquad8");
+
+BiquadBank::BiquadBank()
+{
+    clear();
+}
+
+void BiquadBank::clear()
+{
+    ::memset(_bank, 0, sizeof(_bank));
+}
+
+void BiquadBank::load(int lane, const BiquadFilter::Spec& spec, const BiquadFilter::State& state)
+{
+    jassert(lane >= 0 && lane < NumLanes);
+
+    _bank[B0][lane] = spec.b[0];
+    _bank[B1][lane] = spec.b[1];
+    _bank[B2][lane] = spec.b[2];
+    _bank[A1][lane] = spec.a[1];
+    _bank[A2][lane] = spec.a[2];
+    _bank[X1][lane] = state.x[0];
+    _bank[X2][lane] = state.x[1];
+    _bank[Y1][lane] = state.y[0];
+    _bank[Y2][lane] = state.y[1];
+}
+
+void BiquadBank::store(int lane, BiquadFilter::State& state) const
+{
+    jassert(lane >= 0 && lane < NumLanes);
+
+    state.x[0] = _bank[X1][lane];
+    state.x[1] = _bank[X2][lane];
+    state.y[0] = _bank[Y1][lane];
+    state.y[1] = _bank[Y2][lane];
+}
+
+void BiquadBank::process(float* data, size_t numFrames)
+{
+    simd::biquad8(data, numFrames, &_bank[0][0]);
+}
+
 
 } // namespace dsp
 
@@ -65,6 +65,40 @@ struct BiquadFilter
     static void resetState(const Spec& spec, State& state);
     static float tick(const Spec& spec, State& state, float in);
     static void process(const Spec& spec, State& state, const float* in, float* out, size_t size);
+
+    /// Filter two channels in place with the same coefficients, interleaving their recurrences.
+    static void processStereo(const Spec& spec, State& stateL, State& stateR, float* left, float* right, size_t size);
+};
+
+/**
+ * @brief Independent biquad filters processed together in SIMD lanes.
+ *
+ * The samples are interleaved by lane (transposed layout): frame i of
+ * lane k is at data[i * NumLanes + k]. Filters are loaded into the lanes
+ * before processing and their states stored back afterwards, so that
+ * they can be grouped differently from one block to the next.
+ */
+class BiquadBank
+{
+public:
+
+    constexpr static int NumLanes = 8;
+
+    BiquadBank();
+
+    /// Empty all the lanes, an empty lane outputs silence.
+    void clear();
+
+    void load(int lane, const BiquadFilter::Spec& spec, const BiquadFilter::State& state);
+    void store(int lane, BiquadFilter::State& state) const;
+
+    void process(float* data, size_t numFrames);
+
+private:
+
+    enum Row { B0, B1, B2, A1, A2, X1, X2, Y1, Y2, NumRows };
+
+    alignas(32) float _bank[NumRows][NumLanes];
 };
 
 } // namespace dsp
@@ -17,68 +17,273 @@
 //
 // ----------------------------------------------------------------------------
 
+#include "aeolus/simd.h"
 #include "aeolus/dsp/limiter.h"
 
+#include <cmath>
+#include <cstring>
+
+using namespace juce;
+
 AEOLUS_NAMESPACE_BEGIN
 
 namespace dsp {
 
-void Limiter::updateSpec(Limiter::Spec& spec)
+Limiter::Limiter()
+    : _sampleRate{SAMPLE_RATE_F}
+    , _threshold{1.0f}
+    , _releaseTime{250.0f}
+    , _release{0.0f}
+    , _lookahead{0}
+    , _delay{0}
+    , _interpolators{}
+    , _interpolatorsGain{1.0f}
+    , _audio{}
+    , _peaks{}
+    , _hold{}
+    , _gain{}
+    , _releasedGain{1.0f}
+    , _average{}
+    , _averageIndex{0}
+    , _averageSum{0.0}
+    , _unityFrames{0}
+    , _transparent{true}
+{
+    // Windowed sinc interpolators at 1/4, 2/4 and 3/4 between
+    // the two middle taps, for the 4x oversampled peaks.
+    constexpr float halfWidth = NumTaps / 2;
+
+    for (int p = 0; p < NumPhases; ++p) {
+        auto& h = _interpolators[(size_t)p];
+        const float frac = float(p + 1) / float(NumPhases + 1);
+        float sum = 0.0f;
+
+        for (int j = 0; j < NumTaps; ++j) {
+            const float d = frac + float(DetectionDelay - 1 - j);
+            const float x = MathConstants<float>::pi * d;
+            const float w = 0.42f + 0.5f * std::cos(x / halfWidth) + 0.08f * std::cos(2.0f * x / halfWidth);
+            h[(size_t)j] = std::sin(x) / x * w;
+            sum += h[(size_t)j];
+        }
+
+        float gain = 0.0f;
+
+        for (auto& k : h) {
+            k /= sum;
+            gain += std::abs(k);
+        }
+
+        _interpolatorsGain = jmax(_interpolatorsGain, gain);
+    }
+
+    prepare(SAMPLE_RATE_F, 1.0f);
+}
+
+void Limiter::prepare(float sampleRate, float lookaheadMs)
+{
+    jassert(sampleRate > 0.0f);
+
+    _sampleRate = sampleRate;
+
+    // The detection needs the delayed samples past its taps.
+    _lookahead = jmax(NumTaps - DetectionDelay, roundToInt(lookaheadMs * 0.001f * sampleRate));
+    _delay = _lookahead - 1 + DetectionDelay;
+
+    for (auto& audio : _audio)
+        audio.resize((size_t)(_delay + ChunkLength));
+
+    _peaks.resize((size_t)(_lookahead - 1 + ChunkLength));
+
+    for (auto& hold : _hold)
+        hold.resize(_peaks.size());
+
+    _gain.resize((size_t)ChunkLength);
+    _average.resize((size_t)_lookahead);
+
+    setReleaseTime(_releaseTime);
+    reset();
+}
+
+void Limiter::setReleaseTime(float ms) noexcept
 {
+    _releaseTime = jmax(1.0f, ms);
+    _release = 1.0f - std::exp(-1000.0f / (_releaseTime * _sampleRate));
 }
 
-void Limiter::resetState(const Limiter::Spec& spec, Limiter::State& state)
+void Limiter::reset()
 {
-    state.gain = 1.0f;
-    state.sustain = 0;
+    for (auto& audio : _audio)
+        std::fill(audio.begin(), audio.end(), 0.0f);
+
+    std::fill(_peaks.begin(), _peaks.end(), 0.0f);
+    std::fill(_average.begin(), _average.end(), 1.0f);
+
+    _releasedGain = 1.0f;
+    _averageIndex = 0;
+    _averageSum = (double)_lookahead;
+    _unityFrames = _lookahead;
+    _transparent = true;
 }
 
-float Limiter::tick(const Limiter::Spec& spec, Limiter::State& state, float in)
+bool Limiter::process(float* left, float* right, int numFrames, bool bypass)
 {
-    const float level = std::abs(in);
+    jassert(left != nullptr && right != nullptr);
+
+    bool limited = false;
+
+    for (int offset = 0; offset < numFrames; offset += ChunkLength) {
+        float* out[] = { left + offset, right + offset };
+        limited |= processChunk(out, jmin(ChunkLength, numFrames - offset), bypass);
+    }
+
+    return limited;
+}
+
+bool Limiter::processChunk(float* const* out, int numFrames, bool bypass)
+{
+    const size_t historyLength = (size_t)_delay;
+    const size_t peaksHistoryLength = (size_t)(_lookahead - 1);
+
+    float inputPeak = 0.0f;
 
-    const float targetGain = (level > spec.threshold) ? spec.threshold / level : 1.0f;
+    for (size_t ch = 0; ch < _audio.size(); ++ch) {
+        float* audio = _audio[ch].data();
+        std::memcpy(audio + historyLength, out[ch], sizeof(float) * (size_t)numFrames);
 
-    if (state.gain > targetGain) {
-        state.gain = std::max(state.gain + (targetGain - state.gain) * spec.attack, targetGain);
-        state.sustain = spec.sustain;
+        // Interpolated values are bounded by the samples around.
+        const size_t first = historyLength - (NumTaps - 1);
+        inputPeak = jmax(inputPeak, simd::max_abs(audio + first, (size_t)numFrames + NumTaps - 1));
+    }
+
+    const bool belowThreshold = inputPeak * _interpolatorsGain <= _threshold;
+    bool limited = false;
+
+    if (bypass || (_transparent && belowThreshold)) {
+        // The gain stays at unity, the audio is only delayed.
+        for (size_t ch = 0; ch < _audio.size(); ++ch)
+            std::memcpy(out[ch], _audio[ch].data(), sizeof(float) * (size_t)numFrames);
+
+        if (bypass && !_transparent) {
+            // Leave the gain released when bypassed.
+            std::fill(_average.begin(), _average.end(), 1.0f);
+            _releasedGain = 1.0f;
+            _averageSum = (double)_lookahead;
+            _transparent = true;
+        }
+
+        std::fill(_peaks.begin(), _peaks.begin() + (ptrdiff_t)peaksHistoryLength, 0.0f);
+        _unityFrames = jmin(_unityFrames + numFrames, _lookahead);
     } else {
-        if (state.sustain > 0) {
-            state.sustain--;
-        } else {
-            state.gain = std::min(state.gain + (targetGain - state.gain) * spec.release, targetGain);
+        float* peaks = _peaks.data() + peaksHistoryLength;
+
+        if (belowThreshold)
+            std::fill(peaks, peaks + numFrames, 0.0f);
+        else
+            detectPeaks(peaks, numFrames);
+
+        float* gain = _gain.data();
+        holdPeaks(gain, numFrames);
+
+        // Gain required by the held peaks
+        for (int i = 0; i < numFrames; ++i)
+            gain[i] = gain[i] > _threshold ? _threshold / gain[i] : 1.0f;
+
+        // Instant attack and exponential release, followed by the moving average.
+        float r = _releasedGain;
+        const double scale = 1.0 / _lookahead;
+
+        for (int i = 0; i < numFrames; ++i) {
+            const float g = gain[i];
+            r = g < r ? g : r + (g - r) * _release;
+
+            if (r > 0.9999f)
+                r = 1.0f;
+
+            _unityFrames = r == 1.0f ? jmin(_unityFrames + 1, _lookahead) : 0;
+
+            _averageSum += double(r - _average[(size_t)_averageIndex]);
+            _average[(size_t)_averageIndex] = r;
+            _averageIndex = _averageIndex + 1 == _lookahead ? 0 : _averageIndex + 1;
+
+            // The window is all unity gains, drop the rounding errors.
+            if (_unityFrames == _lookahead)
+                _averageSum = (double)_lookahead;
+
+            gain[i] = float(_averageSum * scale);
+            limited |= gain[i] < 1.0f;
+        }
+
+        _releasedGain = r;
+        _transparent = _unityFrames == _lookahead;
+
+        for (size_t ch = 0; ch < _audio.size(); ++ch) {
+            const float* audio = _audio[ch].data();
+
+            for (int i = 0; i < numFrames; ++i)
+                out[ch][i] = audio[i] * gain[i];
         }
+
+        std::memmove(_peaks.data(), _peaks.data() + numFrames, sizeof(float) * peaksHistoryLength);
     }
 
-    return in * state.gain;
+    for (auto& audio : _audio)
+        std::memmove(audio.data(), audio.data() + numFrames, sizeof(float) * historyLength);
+
+    return limited;
 }
 
-void Limiter::process(const Limiter::Spec& spec, Limiter::State& state, const float* in, float* out, size_t size)
+void Limiter::detectPeaks(float* peaks, int numFrames) const
 {
-    float targetGain = 1.0f;
-    float gain = state.gain;
-    int sustain = state.sustain;
-
-    for (size_t i = 0; i < size; ++i) {
-        const float level = std::abs(in[i]);
-        targetGain = (level > spec.threshold) ? spec.threshold / level : 1.0f;
-
-        if (gain > targetGain) {
-            gain = std::max(gain + (targetGain - gain) * spec.attack, targetGain);
-            sustain = spec.sustain;
-        } else {
-            if (sustain > 0) {
-                sustain--;
-            } else {
-                gain = std::min(gain + (targetGain - gain) * spec.release, targetGain);
+    float acc[ChunkLength];
+
+    std::fill(peaks, peaks + numFrames, 0.0f);
+
+    for (const auto& audio : _audio) {
+        // Taps of the first detected sample
+        const float* x = audio.data() + _delay - (NumTaps - 1);
+
+        for (int i = 0; i < numFrames; ++i)
+            peaks[i] = jmax(peaks[i], std::abs(x[i + DetectionDelay - 1]));
+
+        // Interpolators are applied tap by tap along the chunk, which vectorizes.
+        for (const auto& h : _interpolators) {
+            std::fill(acc, acc + numFrames, 0.0f);
+
+            for (int j = 0; j < NumTaps; ++j) {
+                const float k = h[(size_t)j];
+                const float* xj = x + j;
+
+                for (int i = 0; i < numFrames; ++i)
+                    acc[i] += k * xj[i];
             }
+
+            for (int i = 0; i < numFrames; ++i)
+                peaks[i] = jmax(peaks[i], std::abs(acc[i]));
         }
+    }
+}
+
+void Limiter::holdPeaks(float* held, int numFrames)
+{
+    // Maximum over windows of doubling lengths, each pass
+    // being the maximum of the previous one shifted.
+    const float* src = _peaks.data();
+    size_t length = (size_t)(_lookahead - 1 + numFrames);
+    int window = 1;
+    int pass = 0;
+
+    while (2 * window <= _lookahead) {
+        float* dst = _hold[(size_t)pass].data();
+        simd::max_shifted(dst, src, (size_t)window, length - (size_t)window);
 
-        out[i] = in[i] * gain;
+        length -= (size_t)window;
+        window *= 2;
+        src = dst;
+        pass ^= 1;
     }
 
-    state.gain = gain;
-    state.sustain = sustain;
+    // Two overlapping windows cover the whole lookahead.
+    simd::max_shifted(held, src, (size_t)(_lookahead - window), (size_t)numFrames);
 }
 
 } // namespace dsp
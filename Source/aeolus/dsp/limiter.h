@@ -21,32 +21,101 @@
 
 #include "aeolus/globals.h"
 
+#include <array>
+#include <vector>
+
 AEOLUS_NAMESPACE_BEGIN
 
 namespace dsp {
 
-struct Limiter
+/**
+ * @brief Stereo lookahead limiter.
+ *
+ * Peaks are detected on the 4x oversampled signal (true peaks), and both
+ * channels share the same gain so that the stereo image does not shift.
+ * The audio is delayed by the lookahead, and the gain is computed by blocks:
+ * the required gain is held over the lookahead window (sliding maximum
+ * of the peaks) and smoothed with a moving average of the same length,
+ * so that it has reached the target when the peak comes out.
+ * The gain is then released exponentially.
+ *
+ * As long as the signal stays well below the threshold, the peaks
+ * are not oversampled, and the audio is merely delayed.
+ */
+class Limiter
 {
+public:
+
+    Limiter();
+
+    /**
+     * Configure the limiter.
+     * @param sampleRate Processing sample rate.
+     * @param lookaheadMs Lookahead time, this is the latency as well.
+     * @note This allocates.
+     */
+    void prepare(float sampleRate, float lookaheadMs);
+
+    /// Linear threshold the true peaks are kept under.
+    void setThreshold(float t) noexcept { _threshold = t; }
+    float getThreshold() const noexcept { return _threshold; }
+
+    /// Exponential gain release time constant.
+    void setReleaseTime(float ms) noexcept;
+
+    /// Delay introduced by the limiter (in samples).
+    int getLatency() const noexcept { return _delay; }
+
+    void reset();
+
+    /// Whether the gain is currently left at unity.
+    bool isTransparent() const noexcept { return _transparent; }
+
+    /**
+     * Limit a stereo block in place.
+     * @param bypass Only delay the audio, the same way as when limiting.
+     * @return Whether the gain got reduced in this block.
+     */
+    bool process(float* left, float* right, int numFrames, bool bypass = false);
+
+private:
+
+    constexpr static int ChunkLength = 256;     ///< Block the gain is computed for.
+    constexpr static int NumTaps = 8;           ///< Taps of the inter-samples interpolators.
+    constexpr static int NumPhases = 3;         ///< Interpolated positions between two samples.
+    constexpr static int DetectionDelay = NumTaps / 2;
+
+    bool processChunk(float* const* out, int numFrames, bool bypass);
+
+    /// True peaks of the chunk, for the samples DetectionDelay behind.
+    void detectPeaks(float* peaks, int numFrames) const;
+
+    /// Peaks held over the lookahead window (sliding maximum).
+    void holdPeaks(float* held, int numFrames);
+
+    float _sampleRate;
+    float _threshold;
+    float _releaseTime;         ///< Release time constant (in ms).
+    float _release;             ///< Release coefficient per sample.
+
+    int _lookahead;             ///< Lookahead window (in samples).
+    int _delay;                 ///< Audio delay, lookahead and detection together.
+
+    std::array<std::array<float, NumTaps>, NumPhases> _interpolators;
+    float _interpolatorsGain;   ///< Highest interpolated value for a unit signal.
+
+    std::array<std::vector<float>, 2> _audio;   ///< Delayed audio followed by the chunk, per channel.
+    std::vector<float> _peaks;                  ///< Window of peaks followed by the chunk.
+    std::array<std::vector<float>, 2> _hold;    ///< Sliding maximum passes.
+    std::vector<float> _gain;
 
-    struct Spec
-    {
-        float threshold;
-        float attack;
-        float release;
-        int sustain;
-    };
-
-    struct State
-    {
-        float gain;
-        int sustain;
-    };
-
-    static void updateSpec(Spec& spec);
-    static void resetState(const Spec& spec, State& state);
-    static float tick(const Spec& spec, State& state, float in);
-    static void process(const Spec& spec, State& state, const float* in, float* out, size_t size);
+    float _releasedGain;        ///< Held gain after release.
+    std::vector<float> _average;///< Released gains in the moving average window.
+    int _averageIndex;
+    double _averageSum;
 
+    int _unityFrames;           ///< Consecutive frames computed at unity gain.
+    bool _transparent;
 };
 
 } // namespace dsp
@@ -0,0 +1,259 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "aeolus/simd.h"
+#include "aeolus/dsp/resampler.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace juce;
+
+AEOLUS_NAMESPACE_BEGIN
+
+namespace dsp {
+
+namespace {
+
+struct QualitySpec
+{
+    int zeroCrossings;  // Per side of the kernel
+    int numPhases;
+    double cutoff;      // Relative to the lowest Nyquist frequency
+    double beta;        // Kaiser window parameter
+};
+
+const QualitySpec qualitySpecs[Resampler::NumQualities] = {
+    {  8,  64, 0.84,  6.0 },    // Low
+    { 16, 128, 0.89,  8.0 },    // Medium
+    { 32, 256, 0.92, 10.0 },    // High
+};
+
+/// Zeroth order modified Bessel function of the first kind.
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 32; ++k) {
+        const double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+
+        if (term < 1e-12 * sum)
+            break;
+    }
+
+    return sum;
+}
+
+} // anonymous namespace
+
+String Resampler::getQualityName(Quality quality)
+{
+    switch (quality) {
+    case Low: return "Low";
+    case Medium: return "Medium";
+    case High: return "High";
+    default: break;
+    }
+
+    return "Unknown";
+}
+
+Resampler::Resampler(double ratio, size_t nChannels, int maxBlockSize)
+    : _ratio{ratio}
+    , _quality{Medium}
+    , _maxBlockSize{maxBlockSize}
+    , _halfLength{0}
+    , _numPhases{0}
+    , _phases{}
+    , _kernel{}
+    , _history(nChannels)
+    , _numBuffered{0}
+    , _position{0.0}
+{
+    jassert(ratio > 0.0);
+    jassert(nChannels > 0);
+    jassert(maxBlockSize > 0);
+
+    update();
+}
+
+void Resampler::setRatio(double r)
+{
+    jassert(r > 0.0);
+    _ratio = r;
+    update();
+}
+
+void Resampler::setQuality(Quality q)
+{
+    jassert(q >= 0 && q < NumQualities);
+    _quality = q;
+    update();
+}
+
+void Resampler::setNumberOfChannels(size_t n)
+{
+    jassert(n > 0);
+    _history.resize(n);
+    update();
+}
+
+void Resampler::setMaxBlockSize(int n)
+{
+    jassert(n > 0);
+    _maxBlockSize = n;
+    update();
+}
+
+void Resampler::update()
+{
+    const auto& spec = qualitySpecs[_quality];
+
+    // When downsampling the kernel gets wider, keeping the same
+    // transition band relative to the output rate.
+    const double scale = jmin(1.0, 1.0 / _ratio);
+    const double cutoff = spec.cutoff * scale;
+
+    // Multiple of 4 on each side, so that the taps are a multiple of 8.
+    _halfLength = ((int)std::ceil(spec.zeroCrossings / scale) + 3) & ~3;
+    _numPhases = spec.numPhases;
+
+    const int numTaps = 2 * _halfLength;
+    const double i0beta = besselI0(spec.beta);
+
+    _phases.resize((size_t)((_numPhases + 1) * numTaps));
+
+    for (int p = 0; p <= _numPhases; ++p) {
+        float* kernel = &_phases[(size_t)(p * numTaps)];
+        const double frac = double(p) / double(_numPhases);
+        double sum = 0.0;
+
+        for (int j = 0; j < numTaps; ++j) {
+            // Distance from the tap to the output sample
+            const double d = frac + double(_halfLength - 1 - j);
+            const double r = d / double(_halfLength);
+            const double window = std::abs(r) < 1.0 ? besselI0(spec.beta * std::sqrt(1.0 - r * r)) / i0beta : 0.0;
+            const double x = MathConstants<double>::pi * cutoff * d;
+            const double sinc = d == 0.0 ? 1.0 : std::sin(x) / x;
+            const double h = cutoff * sinc * window;
+
+            kernel[j] = (float)h;
+            sum += h;
+        }
+
+        // Unity DC gain for every phase
+        for (int j = 0; j < numTaps; ++j)
+            kernel[j] = float(kernel[j] / sum);
+    }
+
+    _kernel.resize((size_t)numTaps);
+
+    for (auto& h : _history)
+        h.resize((size_t)(numTaps + _maxBlockSize));
+
+    reset();
+}
+
+void Resampler::reset()
+{
+    for (auto& h : _history)
+        std::fill(h.begin(), h.end(), 0.0f);
+
+    // Silence before the first input sample, which the first output is aligned to.
+    _numBuffered = _halfLength - 1;
+    _position = double(_halfLength - 1);
+}
+
+void Resampler::write(const float* const* in, size_t numChannels, int numSamples)
+{
+    jassert(in != nullptr);
+    jassert(numChannels <= _history.size());
+
+    // Drop the samples the next output does not need anymore.
+    const int first = jmin((int)_position - _halfLength + 1, _numBuffered);
+
+    if (first > 0) {
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            float* h = _history[ch].data();
+            std::memmove(h, h + first, sizeof(float) * (size_t)(_numBuffered - first));
+        }
+
+        _numBuffered -= first;
+        _position -= first;
+    }
+
+    const int capacity = (int)_history[0].size();
+    jassert(_numBuffered + numSamples <= capacity);
+    numSamples = jmin(numSamples, capacity - _numBuffered);
+
+    for (size_t ch = 0; ch < numChannels; ++ch)
+        std::memcpy(_history[ch].data() + _numBuffered, in[ch], sizeof(float) * (size_t)numSamples);
+
+    _numBuffered += numSamples;
+}
+
+int Resampler::read(float* const* out, size_t numChannels, int numSamples)
+{
+    jassert(out != nullptr);
+    jassert(numChannels <= _history.size());
+
+    const size_t numTaps = _kernel.size();
+    int n = 0;
+
+    while (n < numSamples) {
+        const int i = (int)_position;
+
+        if (i + _halfLength >= _numBuffered)
+            break;
+
+        interpolateKernel(_position - i);
+
+        const size_t first = (size_t)(i - _halfLength + 1);
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            out[ch][n] = simd::mul_reduce_unaligned(_kernel.data(), &_history[ch][first], numTaps);
+
+        _position += _ratio;
+        ++n;
+    }
+
+    return n;
+}
+
+void Resampler::interpolateKernel(double frac)
+{
+    const double x = frac * _numPhases;
+    const int p = jmin((int)x, _numPhases - 1);
+    const float a = float(x - p);
+
+    const size_t numTaps = _kernel.size();
+    const float* k0 = &_phases[(size_t)p * numTaps];
+    const float* k1 = k0 + numTaps;
+    float* k = _kernel.data();
+
+    for (size_t j = 0; j < numTaps; ++j)
+        k[j] = k0[j] + a * (k1[j] - k0[j]);
+}
+
+} // namespace dsp
+
+AEOLUS_NAMESPACE_END
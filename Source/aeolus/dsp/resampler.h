@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "aeolus/globals.h"
+#include <vector>
+
+AEOLUS_NAMESPACE_BEGIN
+
+namespace dsp {
+
+/**
+ * @brief Block sample rate converter.
+ *
+ * Polyphase windowed-sinc FIR resampler with an arbitrary ratio.
+ * The kernel for an output sample is interpolated between the two nearest
+ * of the tabulated phases. The cutoff follows the lowest of the input and
+ * output Nyquist frequencies, so that downsampling is anti-aliased.
+ *
+ * Input is written by blocks, and the output is read by blocks as far
+ * as the written input allows it. All the allocations happen when
+ * the resampler is configured, not when processing.
+ */
+class Resampler
+{
+public:
+
+    enum Quality
+    {
+        Low = 0,
+        Medium,
+        High,
+
+        NumQualities
+    };
+
+    static juce::String getQualityName(Quality quality);
+
+    /**
+     * @param ratio Input over output sample rates.
+     * @param nChannels Number of channels to resample.
+     * @param maxBlockSize Longest block of input written at once.
+     */
+    Resampler(double ratio = 1.0, size_t nChannels = 1, int maxBlockSize = SUB_FRAME_LENGTH);
+
+    void setRatio(double r);
+    double getRatio() const noexcept { return _ratio; }
+
+    void setQuality(Quality q);
+    Quality getQuality() const noexcept { return _quality; }
+
+    void setNumberOfChannels(size_t n);
+    size_t getNumberOfChannels() const noexcept { return _history.size(); }
+
+    void setMaxBlockSize(int n);
+
+    /// Number of taps of the interpolated kernel.
+    int getNumTaps() const noexcept { return (int)_kernel.size(); }
+
+    /// Delay introduced by the filter (in input samples).
+    int getLatency() const noexcept { return _halfLength; }
+
+    void reset();
+
+    /**
+     * Append a block of input samples.
+     * @param in Channels samples, only the first numChannels are written.
+     */
+    void write(const float* const* in, size_t numChannels, int numSamples);
+
+    /**
+     * Produce up to numSamples output samples from the input written so far.
+     * @return Number of samples produced, per channel.
+     */
+    int read(float* const* out, size_t numChannels, int numSamples);
+
+private:
+
+    /// Rebuild the phases table and the history buffers.
+    void update();
+
+    /// Interpolate the kernel for the fractional position.
+    void interpolateKernel(double frac);
+
+    double _ratio;
+    Quality _quality;
+    int _maxBlockSize;
+
+    int _halfLength;                ///< Kernel half length (in input samples).
+    int _numPhases;
+    std::vector<float> _phases;     ///< (_numPhases + 1) kernels, one after the other.
+    std::vector<float> _kernel;     ///< Kernel for the current output sample.
+
+    std::vector<std::vector<float>> _history;   ///< Input samples still needed, per channel.
+    int _numBuffered;
+    double _position;               ///< Position of the next output sample in the history.
+};
+
+} // namespace dsp
+
+AEOLUS_NAMESPACE_END
@@ -57,9 +57,19 @@ void SpatialSource::tick(float x, float& l, float& r)
 }
 
 void SpatialSource::process(float* in, float* outL, float* outR, int numFrames)
+{
+    processUnfiltered(in, outL, outR, numFrames);
+
+    BiquadFilter::process(_filterSpec[0], _filterState[0], outL, outL, (size_t)numFrames);
+    BiquadFilter::process(_filterSpec[1], _filterState[1], outR, outR, (size_t)numFrames);
+}
+
+void SpatialSource::processUnfiltered(const float* in, float* outL, float* outR, int numFrames, int stride)
 {
     for (int i = 0; i < numFrames; ++i) {
-        tick(in[i], outL[i], outR[i]);
+        _delayLine.write(in[i]);
+        outL[i * stride] = _delayLine.readNearest(_leftDelay) * _leftAttenuation;
+        outR[i * stride] = _delayLine.readNearest(_rightDelay) * _rightAttenuation;
     }
 }
 
@@ -106,7 +116,7 @@ void SpatialSource::recalculate()
     _filterSpec[0].type = BiquadFilter::LowPass;
     _filterSpec[0].dbGain = 0.0f;
     _filterSpec[0].q = 0.7071f;
-    _filterSpec[0].sampleRate = SAMPLE_RATE;
+    _filterSpec[0].sampleRate = _sampleRate;
 
     _filterSpec[1] = _filterSpec[0];
 
@@ -72,6 +72,17 @@ public:
 
     void process(float* in, float* outL, float* outR, int numFrames);
 
+    /**
+     * Delay and attenuate without the attenuation filters, which are left
+     * to the caller (to be processed along with other sources).
+     * @param stride Distance between two output frames.
+     */
+    void processUnfiltered(const float* in, float* outL, float* outR, int numFrames, int stride = 1);
+
+    /// Attenuation filter of the left (0) or right (1) channel.
+    const BiquadFilter::Spec& getFilterSpec(int ch) const noexcept { return _filterSpec[ch]; }
+    BiquadFilter::State& getFilterState(int ch) noexcept { return _filterState[ch]; }
+
     void setSampleRate(float sr) { _sampleRate = sr; }
     void setSourcePosition(float x, float y) noexcept { _sourcePosition = {x, y}; }
     void setListenerPosition(float x, float y) noexcept { _listenerPosition = {x, y}; }
@@ -18,6 +18,7 @@
 // ----------------------------------------------------------------------------
 
 #include "aeolus/engine.h"
+#include "aeolus/simd.h"
 
 using namespace juce;
 
@@ -56,6 +57,17 @@ const static char* tuningFrequency = "tuningFrequency";
 const static char* tuningTemperament = "tuningTemperament";
 const static char* mtsEnabled = "mtsEnabled";
 const static char* uiScalingFactor = "uiScalingFactor";
+const static char* realtimeScheduling = "realtimeScheduling";
+const static char* realtimePriority = "realtimePriority";
+const static char* realtimeAffinity = "realtimeAffinity";
+const static char* realtimeThreads = "realtimeThreads";
+const static char* bulkAffinity = "bulkAffinity";
+const static char* bulkThreads = "bulkThreads";
+const static char* nativeSampleRate = "nativeSampleRate";
+const static char* resamplingQuality = "resamplingQuality";
+const static char* renderAheadSubFrames = "renderAheadSubFrames";
+const static char* limiterLookahead = "limiterLookahead";
+const static char* reverbTailDecimation = "reverbTailDecimation";
 }
 
 EngineGlobal::EngineGlobal()
@@ -136,6 +148,30 @@ void EngineGlobal::loadSettings()
         const float uiScalingFactor = (float)propertiesFile->getDoubleValue(settings::uiScalingFactor, UI_SCALING_DEFAULT);
         if (uiScalingFactor >= UI_SCALING_MIN && uiScalingFactor <= UI_SCALING_MAX)
             _uiScalingFactor = uiScalingFactor;
+
+        const int scheduling = propertiesFile->getIntValue(settings::realtimeScheduling, (int)ThreadPolicy::Normal);
+
+        if (scheduling >= 0 && scheduling < (int)ThreadPolicy::NumSchedulings)
+            _realtimeThreadPolicy.scheduling = static_cast<ThreadPolicy::Scheduling>(scheduling);
+
+        _realtimeThreadPolicy.priority = jlimit(ThreadPolicy::MinPriority, ThreadPolicy::MaxPriority,
+                                                propertiesFile->getIntValue(settings::realtimePriority, ThreadPolicy::DefaultPriority));
+        _realtimeThreadPolicy.affinity = propertiesFile->getValue(settings::realtimeAffinity);
+        _realtimeThreadsCount = jlimit(0, SystemStats::getNumCpus(), propertiesFile->getIntValue(settings::realtimeThreads, 0));
+
+        _bulkThreadPolicy.affinity = propertiesFile->getValue(settings::bulkAffinity);
+        _bulkThreadsCount = jlimit(0, SystemStats::getNumCpus(), propertiesFile->getIntValue(settings::bulkThreads, 0));
+
+        _nativeSampleRate = propertiesFile->getBoolValue(settings::nativeSampleRate, false);
+
+        const int resamplingQuality = propertiesFile->getIntValue(settings::resamplingQuality, (int)dsp::Resampler::Medium);
+
+        if (resamplingQuality >= 0 && resamplingQuality < (int)dsp::Resampler::NumQualities)
+            _resamplingQuality = static_cast<dsp::Resampler::Quality>(resamplingQuality);
+
+        setRenderAheadSubFrames(propertiesFile->getIntValue(settings::renderAheadSubFrames, 0));
+        setLimiterLookahead(propertiesFile->getIntValue(settings::limiterLookahead, DefaultLimiterLookahead));
+        setReverbTailDecimation(propertiesFile->getIntValue(settings::reverbTailDecimation, 1));
     }
 }
 
@@ -146,6 +182,17 @@ void EngineGlobal::saveSettings()
         propertiesFile->setValue(settings::tuningTemperament, (int)_scale.getType());
         propertiesFile->setValue(settings::mtsEnabled, _mtsEnabled);
         propertiesFile->setValue(settings::uiScalingFactor, _uiScalingFactor);
+        propertiesFile->setValue(settings::realtimeScheduling, (int)_realtimeThreadPolicy.scheduling);
+        propertiesFile->setValue(settings::realtimePriority, _realtimeThreadPolicy.priority);
+        propertiesFile->setValue(settings::realtimeAffinity, _realtimeThreadPolicy.affinity);
+        propertiesFile->setValue(settings::realtimeThreads, _realtimeThreadsCount);
+        propertiesFile->setValue(settings::bulkAffinity, _bulkThreadPolicy.affinity);
+        propertiesFile->setValue(settings::bulkThreads, _bulkThreadsCount);
+        propertiesFile->setValue(settings::nativeSampleRate, _nativeSampleRate);
+        propertiesFile->setValue(settings::resamplingQuality, (int)_resamplingQuality);
+        propertiesFile->setValue(settings::renderAheadSubFrames, _renderAheadSubFrames);
+        propertiesFile->setValue(settings::limiterLookahead, _limiterLookahead);
+        propertiesFile->setValue(settings::reverbTailDecimation, _reverbTailDecimation);
     }
 
     _globalProperties.saveIfNeeded();
@@ -173,12 +220,17 @@ void EngineGlobal::updateStops(float sampleRate)
 {
     _sampleRate = sampleRate;
 
-    ThreadPool threadPool;
+    if (_bulkThreadPool == nullptr) {
+        const int numThreads = _bulkThreadsCount > 0 ? _bulkThreadsCount : SystemStats::getNumCpus();
+        _bulkThreadPool = std::make_unique<ThreadPool>(numThreads);
+    }
+
     std::atomic<int> done((int)_rankwaves.size());
     WaitableEvent wait;
 
     for (auto* rw : _rankwaves) {
-        threadPool.addJob([sampleRate, rw, &done, &wait]() {
+        _bulkThreadPool->addJob([this, sampleRate, rw, &done, &wait]() {
+                applyBulkThreadPolicy();
                 rw->prepareToPlay(sampleRate);
                 done -= 1;
                 wait.signal();
@@ -195,6 +247,38 @@ void EngineGlobal::updateStops(float sampleRate)
 */
 }
 
+float EngineGlobal::prepareStops(const Engine& engine, float hostSampleRate)
+{
+    const float sampleRate = _nativeSampleRate ? hostSampleRate : SAMPLE_RATE_F;
+
+    updateStops(sampleRate);
+
+    // The other engines would be detuned by the wavetables built for another rate.
+    for (auto* proxy : _processors) {
+        auto& other = proxy->getEngine();
+
+        if (&other != &engine && other.isPrepared() && other.getRenderSampleRate() != sampleRate) {
+            auto* processor = proxy->getAudioProcessor();
+            const bool wasSuspended = processor->isSuspended();
+
+            processor->suspendProcessing(true);
+            other.setRenderSampleRate(sampleRate);
+            processor->setLatencySamples(other.getLatencySamples());
+            processor->suspendProcessing(wasSuspended);
+        }
+    }
+
+    return sampleRate;
+}
+
+String EngineGlobal::getRenderingReport()
+{
+    if (_processors.isEmpty())
+        return "idle";
+
+    return _processors.getFirst()->getEngine().getRenderingReport();
+}
+
 bool EngineGlobal::isConnectedToMTSMaster()
 {
     if (_mtsClient != nullptr)
@@ -247,6 +331,86 @@ void EngineGlobal::setUIScalingFactor(float f)
     _listeners.call([&](Listener& listener){ listener.onUIScalingFactorChanged(_uiScalingFactor); });
 }
 
+void EngineGlobal::setLimiterLookahead(int ms) noexcept
+{
+    constexpr int lookaheads[] = { 1, 2, 5, MaxLimiterLookahead };
+
+    _limiterLookahead = MaxLimiterLookahead;
+
+    for (int lookahead : lookaheads) {
+        if (ms <= lookahead) {
+            _limiterLookahead = lookahead;
+            break;
+        }
+    }
+}
+
+void EngineGlobal::setRealtimeThreadPolicy(const ThreadPolicy& policy)
+{
+    if (policy == _realtimeThreadPolicy)
+        return;
+
+    _realtimeThreadPolicy = policy;
+
+    for (auto* proxy : _processors)
+        proxy->getEngine().updateThreadPolicy();
+}
+
+void EngineGlobal::setBulkThreadPolicy(const ThreadPolicy& policy)
+{
+    std::lock_guard<std::mutex> lock(_bulkThreadPolicyMutex);
+
+    if (policy == _bulkThreadPolicy)
+        return;
+
+    _bulkThreadPolicy = policy;
+    ++_bulkThreadPolicyGeneration;
+}
+
+void EngineGlobal::applyBulkThreadPolicy()
+{
+    thread_local int appliedGeneration = -1;
+
+    if (appliedGeneration == _bulkThreadPolicyGeneration.load())
+        return;
+
+    std::lock_guard<std::mutex> lock(_bulkThreadPolicyMutex);
+
+    appliedGeneration = _bulkThreadPolicyGeneration.load();
+    _bulkAppliedThreadPolicy = _bulkThreadPolicy.applyToCurrentThread();
+}
+
+String EngineGlobal::getThreadingReport()
+{
+    String report = "Reverb: ";
+
+    if (_processors.isEmpty()) {
+        report << "idle";
+    } else {
+        const auto& engine = _processors.getFirst()->getEngine();
+        const auto stats = engine.getReverbWorkerStats();
+
+        report << engine.getReverbThreadPolicy()
+               << "\nReverb jobs: " << String((int64) stats.missedDeadlines) << " missed, "
+               << String((int64) stats.rejectedJobs) << " rejected"
+               << "\nReverb wake: avg " << String(stats.averageLatencyMs, 2) << " ms, max "
+               << String(stats.maxLatencyMs, 2) << " ms";
+    }
+
+    report << "\nWavetables: ";
+
+    {
+        std::lock_guard<std::mutex> lock(_bulkThreadPolicyMutex);
+
+        if (_bulkThreadPool != nullptr)
+            report << _bulkThreadPool->getNumThreads() << " x ";
+
+        report << _bulkAppliedThreadPolicy;
+    }
+
+    return report;
+}
+
 void EngineGlobal::rebuildRankwaves()
 {
     // Prepare all the rankwaves to be retuned
@@ -292,7 +456,7 @@ void EngineGlobal::loadIRs()
         0.25f,
         zeroDelay,
         zeroDelay ? 0 : 216,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -302,7 +466,7 @@ void EngineGlobal::loadIRs()
         0.8f,
         zeroDelay,
         zeroDelay ? 0 : 15,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -312,7 +476,7 @@ void EngineGlobal::loadIRs()
         1.0f,
         zeroDelay,
         zeroDelay ? 0 : 1796,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -322,7 +486,7 @@ void EngineGlobal::loadIRs()
         1.0f,
         zeroDelay,
         zeroDelay ? 0 : 1776,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -332,7 +496,7 @@ void EngineGlobal::loadIRs()
         1.0f,
         zeroDelay,
         zeroDelay ? 0 : 385,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -342,7 +506,7 @@ void EngineGlobal::loadIRs()
         1.0f,
         zeroDelay,
         zeroDelay ? 0 : 1764,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -352,7 +516,7 @@ void EngineGlobal::loadIRs()
         0.1f,
         false,  // This one is delayed on purpose
         0,      // 28
-        {}
+        0
     });
 
     _irs.push_back({
@@ -362,7 +526,7 @@ void EngineGlobal::loadIRs()
         0.4f,
         zeroDelay,
         zeroDelay ? 0 : 1995,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -372,7 +536,7 @@ void EngineGlobal::loadIRs()
         0.4f,
         zeroDelay,
         zeroDelay ? 0 : 1309,
-        {}
+        0
     });
 
     _irs.push_back({
@@ -382,7 +546,7 @@ void EngineGlobal::loadIRs()
         0.3f,
         zeroDelay,
         zeroDelay ? 0 : 3098,
-        {}
+        0
     });
 
     AudioFormatManager manager;
@@ -391,18 +555,121 @@ void EngineGlobal::loadIRs()
     // A minimum size we can have is a single convolution block.
     _longestIRLength = dsp::Convolver::BlockSize;
 
+    // Only the headers are read here, waveforms are decoded on first use.
     for (auto& ir : _irs) {
         std::unique_ptr<InputStream> stream = std::make_unique<MemoryInputStream>(ir.data, ir.size, false);
         std::unique_ptr<AudioFormatReader> reader{manager.createReaderFor(std::move(stream))};
-        ir.waveform.setSize(reader->numChannels, (int)reader->lengthInSamples);
-        const auto offset{ (juce::int64)ir.startOffset };
-        reader->read(&ir.waveform, 0, (int)(ir.waveform.getNumSamples() - offset), offset, true, true);
+        ir.length = reader != nullptr ? (int)reader->lengthInSamples : 0;
+        ir.sampleRate = reader != nullptr ? (float)reader->sampleRate : SAMPLE_RATE_F;
+
+        _longestIRLength = jmax(_longestIRLength, ir.length);
+    }
+
+    _irWaveforms.assign(_irs.size(), nullptr);
+    _irWaveformsSampleRates.assign(_irs.size(), 0.0f);
+    _irUsage.clear();
+}
 
-        ir.waveform.applyGain(ir.gain);
+// @internal Windowed-sinc resampling of a decoded IR, done once per rate.
+static std::shared_ptr<AudioBuffer<float>> resampleIR(const AudioBuffer<float>& in, double ratio)
+{
+    constexpr int halfLength = 16; // In number of zero-crossings of the filter
+
+    // Cut off below the lowest of the two Nyquist frequencies.
+    const double cutoff = 0.95 * jmin(1.0, ratio);
+    const double width = halfLength / cutoff;
+
+    const int inLength = in.getNumSamples();
+    const int outLength = (int)std::ceil(inLength * ratio);
+    auto out = std::make_shared<AudioBuffer<float>>(in.getNumChannels(), outLength);
+
+    for (int ch = 0; ch < in.getNumChannels(); ++ch) {
+        const float* x = in.getReadPointer(ch);
+        float* y = out->getWritePointer(ch);
+
+        for (int n = 0; n < outLength; ++n) {
+            const double t = n / ratio;
+            const int first = jmax(0, (int)std::ceil(t - width));
+            const int last = jmin(inLength - 1, (int)std::floor(t + width));
+            double acc = 0.0;
+
+            for (int k = first; k <= last; ++k) {
+                const double u = k - t;
+                const double v = MathConstants<double>::pi * cutoff * u;
+                const double sinc = u == 0.0 ? 1.0 : std::sin(v) / v;
+                const double window = 0.42 + 0.5 * std::cos(MathConstants<double>::pi * u / width)
+                                    + 0.08 * std::cos(MathConstants<double>::twoPi * u / width);
+                acc += x[k] * cutoff * sinc * window;
+            }
 
-        _longestIRLength = jmax(_longestIRLength, ir.waveform.getNumSamples());
+            y[n] = (float)acc;
+        }
     }
 
+    return out;
+}
+
+std::shared_ptr<AudioBuffer<float>> EngineGlobal::decodeIR(const IR& ir, float sampleRate) const
+{
+    AudioFormatManager manager;
+    manager.registerBasicFormats();
+
+    std::unique_ptr<InputStream> stream = std::make_unique<MemoryInputStream>(ir.data, ir.size, false);
+    std::unique_ptr<AudioFormatReader> reader{manager.createReaderFor(std::move(stream))};
+
+    if (reader == nullptr)
+        return nullptr;
+
+    auto waveform = std::make_shared<AudioBuffer<float>>((int)reader->numChannels, (int)reader->lengthInSamples);
+    const auto offset{ (juce::int64)ir.startOffset };
+    reader->read(waveform.get(), 0, (int)(waveform->getNumSamples() - offset), offset, true, true);
+
+    waveform->applyGain(ir.gain);
+
+    if (reader->sampleRate != (double)sampleRate)
+        waveform = resampleIR(*waveform, sampleRate / reader->sampleRate);
+
+    return waveform;
+}
+
+std::shared_ptr<const AudioBuffer<float>> EngineGlobal::getIRWaveform(int index, float sampleRate)
+{
+    if (index < 0 || index >= (int)_irs.size())
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(_irWaveformsMutex);
+
+    auto& waveform = _irWaveforms[(size_t)index];
+
+    // Only one rate is kept per IR, engines normally share the same one.
+    if (waveform == nullptr || _irWaveformsSampleRates[(size_t)index] != sampleRate) {
+        waveform = decodeIR(_irs[(size_t)index], sampleRate);
+        _irWaveformsSampleRates[(size_t)index] = sampleRate;
+    }
+
+    _irUsage.erase(std::remove(_irUsage.begin(), _irUsage.end(), index), _irUsage.end());
+    _irUsage.push_back(index);
+
+    // Evict the least recently used waveforms, the engines
+    // still using one keep their reference.
+    const auto bytes = [this](int i) {
+        const auto& w = _irWaveforms[(size_t)i];
+        return w == nullptr ? (size_t)0 : sizeof(float) * (size_t)w->getNumChannels() * (size_t)w->getNumSamples();
+    };
+
+    size_t total = 0;
+
+    for (int i : _irUsage)
+        total += bytes(i);
+
+    while (total > IRCacheBudget && _irUsage.size() > 1) {
+        const int i = _irUsage.front();
+        total -= bytes(i);
+        _irWaveforms[(size_t)i] = nullptr;
+        _irUsage.erase(_irUsage.begin());
+    }
+
+    return waveform;
 }
 
 bool EngineGlobal::updateMTSTuningCache()
@@ -438,6 +705,10 @@ JUCE_IMPLEMENT_SINGLETON(EngineGlobal)
 
 Engine::Engine()
     : _sampleRate{SAMPLE_RATE_F}
+    , _renderSampleRate{SAMPLE_RATE_F}
+    , _reverbSampleRate{SAMPLE_RATE_F}
+    , _subFrameLengthHost{(float)SUB_FRAME_LENGTH}
+    , _hostBlockSize{SUB_FRAME_LENGTH}
     , _voicePool(*this)
     , _params{NUM_PARAMS}
     , _divisions{}
@@ -448,11 +719,16 @@ Engine::Engine()
     , _remainedSamples{0}
     , _tremulantBuffer{1, SUB_FRAME_LENGTH}
     , _tremulantPhase{0.0f}
+    , _tremulantPhaseIncrement{MathConstants<float>::twoPi * TREMULANT_FREQUENCY / SAMPLE_RATE_F}
     , _convolver{}
     , _selectedIR{0}
     , _irSwitchEvents{}
+    , _pendingIR{-1}
     , _reverbTailCounter{0}
-    , _interpolator{1.0f, N_OUTPUT_CHANNELS}
+    , _resampler{1.0, N_OUTPUT_CHANNELS, SUB_FRAME_LENGTH}
+    , _idleHoldFrames{2 * SUB_FRAME_LENGTH}
+    , _idleCountdown{0}
+    , _idle{false}
     , _midiKeyboardState{}
     , _volumeLevel{}
     , _midiControlChannelsMask{ (1 << 16) - 1 }
@@ -460,34 +736,193 @@ Engine::Engine()
 {
     populateDivisions();
 
+    // Reverb IRs and their spectra are shared by all the instances.
+    _convolver.setIRProvider(EngineGlobal::getInstance());
+    _convolver.setSpectraCache(&EngineGlobal::getInstance()->getIRSpectraCache());
+
     // Sequencer can be created only after the divisions have been populated.
     _sequencer = std::make_unique<Sequencer>(*this, SEQUENCER_N_STEPS);
 }
 
+Engine::~Engine()
+{
+    _renderAhead.stop();
+    _isPrepared = false;
+}
+
 void Engine::prepareToPlay(float sampleRate, int frameSize)
 {
-    ignoreUnused(frameSize);
+    // The render thread owns the engine state while running.
+    _renderAhead.stop();
+    _hostBlockSize = jmax(1, frameSize);
+    _sampleRate = sampleRate;
 
     // Make sure the stops wavetable is updated.
+    prepareRendering(EngineGlobal::getInstance()->prepareStops(*this, sampleRate));
+}
+
+void Engine::setRenderSampleRate(float renderSampleRate)
+{
+    _renderAhead.stop();
+    prepareRendering(renderSampleRate);
+}
+
+void Engine::prepareRendering(float renderSampleRate)
+{
     auto* g = EngineGlobal::getInstance();
-    g->updateStops(SAMPLE_RATE_F);
+    const float sampleRate = _sampleRate;
+
+    _renderSampleRate = renderSampleRate;
+    _isPrepared = true;
 
-    _limiterSpec.threshold = 0.8f;
-    _limiterSpec.attack = 1000.0f / sampleRate;
-    _limiterSpec.release = 1.0f / sampleRate;
-    _limiterSpec.sustain = std::max(0, int(sampleRate * 0.5f));
+    // The reverb runs at the host rate, its IR is resampled
+    // accordingly when rendering natively.
+    _reverbSampleRate = g->isNativeSampleRate() ? sampleRate : SAMPLE_RATE_F;
 
-    for (auto& state : _limiterState)
-        dsp::Limiter::resetState(_limiterSpec, state);
+    for (auto* division : _divisions)
+        division->prepareToPlay(_renderSampleRate);
+
+    _tremulantPhaseIncrement = MathConstants<float>::twoPi * TREMULANT_FREQUENCY / _renderSampleRate;
+
+    _limiter.setThreshold(0.8f);
+    _limiter.prepare(sampleRate, (float)g->getLimiterLookahead());
+
+    _convolver.setHybrid(g->getReverbTailDecimation());
 
     // Select the first IR for reverb by default
+    _pendingIR = -1;
     setReverbIR(_selectedIR);
     _convolver.setDryWet(1.0f, 0.25f, true);
 
-    _interpolator.setRatio(SAMPLE_RATE_F / sampleRate); // 44100 / sampleRate
-    _interpolator.reset();
+    // The resampler is bypassed when rendering at the host rate.
+    _resampler.setQuality(g->getResamplingQuality());
+    _resampler.setRatio(double(_renderSampleRate) / double(sampleRate));
 
-    _sampleRate = sampleRate;
+    updateThreadPolicy(true);
+
+    _subFrameLengthHost = SUB_FRAME_LENGTH * sampleRate / _renderSampleRate;
+
+    // Whatever the last sub-frame leaves in the resampler
+    // and the limiter must be output before idling.
+    _idleHoldFrames = 2 * (int)std::ceil(_subFrameLengthHost) + _limiter.getLatency();
+
+    if (isResampling())
+        _idleHoldFrames += (int)std::ceil(_resampler.getLatency() / _resampler.getRatio());
+
+    _idleCountdown = _idleHoldFrames;
+    _idle = false;
+
+    startRenderAhead();
+}
+
+void Engine::releaseResources()
+{
+    _renderAhead.stop();
+    _isPrepared = false;
+}
+
+void Engine::startRenderAhead()
+{
+    auto* g = EngineGlobal::getInstance();
+    const int numSubFrames = g->getRenderAheadSubFrames();
+
+    if (numSubFrames <= 0)
+        return;
+
+    // A host block must be ready when the callback starts, the extra
+    // sub-frames absorb the rendering jitter.
+    const int subFrameFrames = (int)std::ceil(_subFrameLengthHost);
+    const int targetFrames = _hostBlockSize + numSubFrames * subFrameFrames;
+    const int maxRenderFrames = subFrameFrames + 1;
+
+    _renderAheadBuffer.setSize(N_OUTPUT_CHANNELS, maxRenderFrames);
+
+    TimedMidiMessage message;
+
+    while (_renderAheadMIDIMessages.receive(message)) {
+        // Left from a previous run, on another clock.
+    }
+
+    _hasRenderAheadHeldMessage = false;
+    _renderAheadClock = 0;
+    _renderAheadPosition = 0.0;
+    _remainedSamples = 0;
+
+    _renderAhead.start(N_OUTPUT_CHANNELS, targetFrames, maxRenderFrames, g->getRealtimeThreadPolicy(),
+                       [this] { renderAhead(); });
+}
+
+void Engine::renderAhead()
+{
+    if (_allNotesOffPending.exchange(false))
+        releaseAllNotes();
+
+    processPendingNoteEvents();
+
+    // Messages are snapped to the nearest sub-frame boundary.
+    processRenderAheadMIDIMessagesUpTo(_renderAheadPosition + 0.5 * _subFrameLengthHost);
+
+    if (processSubFrame())
+        _renderAheadAudioGenerated = true;
+
+    _remainedSamples = 0;
+
+    const float* const* data = _subFrameBuffer.getArrayOfReadPointers();
+    int numFrames = SUB_FRAME_LENGTH;
+
+    if (isResampling()) {
+        _resampler.write(data, N_OUTPUT_CHANNELS, SUB_FRAME_LENGTH);
+        numFrames = _resampler.read(_renderAheadBuffer.getArrayOfWritePointers(), N_OUTPUT_CHANNELS, _renderAheadBuffer.getNumSamples());
+        data = _renderAheadBuffer.getArrayOfReadPointers();
+    }
+
+    _renderAhead.write(data, N_OUTPUT_CHANNELS, numFrames);
+    _renderAheadPosition += numFrames;
+}
+
+bool Engine::pullRenderedAhead(float* const* out, int numChannels, int numFrames,
+                               const MidiBuffer& midiMessages, bool isNonRealtime)
+{
+    // Everything rendered from now on is heard after the latency.
+    const int64 position = _renderAheadClock + _renderAhead.getTargetFrames();
+
+    for (const auto metadata : midiMessages) {
+        // Only notes and controllers are handled by the engine.
+        if (metadata.numBytes > 3)
+            continue;
+
+        TimedMidiMessage message{};
+        message.position = position + metadata.samplePosition;
+        message.size = metadata.numBytes;
+        memcpy(message.data, metadata.data, (size_t)metadata.numBytes);
+
+        _renderAheadMIDIMessages.send(message);
+    }
+
+    // Offline rendering waits for the frames, an underrun does not move
+    // the MIDI timing otherwise, as the render thread drops the late frames.
+    _renderAhead.read(out, numChannels, numFrames, isNonRealtime);
+    _renderAheadClock += numFrames;
+
+    return _renderAheadAudioGenerated.exchange(false);
+}
+
+void Engine::processRenderAheadMIDIMessagesUpTo(double position)
+{
+    for (;;) {
+        if (!_hasRenderAheadHeldMessage) {
+            if (!_renderAheadMIDIMessages.receive(_renderAheadHeldMessage))
+                break;
+
+            _hasRenderAheadHeldMessage = true;
+        }
+
+        if ((double)_renderAheadHeldMessage.position > position)
+            break;
+
+        processMIDIMessage(MidiMessage(_renderAheadHeldMessage.data, _renderAheadHeldMessage.size));
+        _hasRenderAheadHeldMessage = false;
+    }
 }
 
 void Engine::setReverbIR(int num)
@@ -497,15 +932,60 @@ void Engine::setReverbIR(int num)
 
     if (num >= 0 && num < irs.size()) {
         const auto& ir = irs[num];
-        _convolver.setLength(int(ir.waveform.getNumSamples() / dsp::Convolver::BlockSize + 1) * dsp::Convolver::BlockSize);
-        _convolver.prepareToPlay(SAMPLE_RATE_F, SUB_FRAME_LENGTH); // these parameters are irrelevant
+        const auto waveform = g->getIRWaveform(num, _reverbSampleRate);
+
+        if (waveform == nullptr)
+            return;
+
+        setReverbLength(ir);
+        _convolver.prepareToPlay(_reverbSampleRate, (size_t) _hostBlockSize);
+        _convolver.setZeroDelay(ir.zeroDelay);
+        _convolver.setIR(*waveform, num);
+
+        _reverbTailCounter = _convolver.length();
+
+        _selectedIR = num;
+    }
+}
+
+bool Engine::loadReverbIR(int num)
+{
+    auto* g = EngineGlobal::getInstance();
+    const auto& irs = g->getIRs();
+
+    if (num >= 0 && num < irs.size()) {
+        const auto& ir = irs[num];
+        setReverbLength(ir);
         _convolver.setZeroDelay(ir.zeroDelay);
-        _convolver.setIR(ir.waveform);
+
+        // The waveform is decoded, if needed, on the convolver loader thread.
+        if (!_convolver.loadIR(num))
+            return false;
 
         _reverbTailCounter = _convolver.length();
 
         _selectedIR = num;
     }
+
+    return true;
+}
+
+void Engine::setReverbLength(const EngineGlobal::IR& ir)
+{
+    const float irSampleRate = ir.sampleRate > 0.0f ? ir.sampleRate : _reverbSampleRate;
+    const int length = (int)std::ceil(ir.length * _reverbSampleRate / irSampleRate);
+
+    _convolver.setLength(int(length / dsp::Convolver::BlockSize + 1) * dsp::Convolver::BlockSize);
+}
+
+void Engine::updateThreadPolicy(bool updateThreadsCount)
+{
+    auto* g = EngineGlobal::getInstance();
+
+    _convolver.setWorkerThreadPolicy(g->getRealtimeThreadPolicy());
+
+    if (updateThreadsCount)
+        _convolver.setWorkerThreadsCount(g->getRealtimeThreadsCount());
 }
 
 void Engine::postReverbIR(int num)
@@ -519,7 +999,107 @@ void Engine::postReverbIR(int num)
 
 float Engine::getReverbLengthInSeconds() const
 {
-    return float(_convolver.length()) * SAMPLE_RATE_R;
+    return float(_convolver.length()) / _reverbSampleRate;
+}
+
+String Engine::getRenderingReport() const
+{
+    String report = String(roundToInt(_renderSampleRate)) + " Hz";
+
+    if (isResampling())
+        report << ", resampled to " << String(roundToInt(_sampleRate)) << " Hz ("
+               << dsp::Resampler::getQualityName(_resampler.getQuality()) << ")";
+    else
+        report << ", native";
+
+    const auto loadToString = [](float load) {
+        return load > 0.0f ? String(100.0f * load, 1) + "%" : String("n/a");
+    };
+
+    report << "\nLoad: native " << loadToString(_renderLoad[0])
+           << ", resampled " << loadToString(_renderLoad[1]);
+
+    report << "\nReverb: " << _convolver.getHybridReport();
+
+    if (isRenderingAhead()) {
+        report << "\nRender ahead: " << String(1000.0f * _renderAhead.getTargetFrames() / _sampleRate, 1) << " ms, "
+               << String((int64)_renderAhead.getNumUnderruns()) << " underruns";
+    }
+
+    return report;
+}
+
+int Engine::getLatencySamples() const noexcept
+{
+    int latency = isRenderingAhead() ? _renderAhead.getTargetFrames() : 0;
+
+    // The resampler filter delays by its half length, in input samples.
+    if (isResampling())
+        latency += (int)std::ceil(_resampler.getLatency() / _resampler.getRatio());
+
+#if AEOLUS_MULTIBUS_OUTPUT
+    return latency;
+#else
+    return latency + _limiter.getLatency();
+#endif
+}
+
+bool Engine::canIdle(const MidiBuffer& midiMessages) const
+{
+    // The render thread owns the voices and the keys state.
+    if (isRenderingAhead())
+        return false;
+
+    if (_idleCountdown > 0 || !midiMessages.isEmpty() || !_pendingNoteEvents.isEmpty())
+        return false;
+
+    if (_voicePool.getNumberOfActiveVoices() > 0)
+        return false;
+
+    // Held keys sound as soon as a stop gets enabled.
+    for (const auto* division : _divisions) {
+        if (division->hasKeysPressed())
+            return false;
+    }
+
+    return true;
+}
+
+void Engine::processIdle(float* const* out, int numChannels, int numFrames)
+{
+    if (!_idle) {
+        // Everything has been silent for a while, so that the state
+        // can be settled at once: the next note starts from a clean slate.
+        _params[VOLUME].setValue(_params[VOLUME].target(), true);
+
+        _limiter.reset();
+
+        _idle = true;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        FloatVectorOperations::clear(out[ch], numFrames);
+}
+
+void Engine::updateIdleCountdown(bool wasAudioGenerated, int numFrames)
+{
+    if (wasAudioGenerated)
+        _idleCountdown = _idleHoldFrames;
+    else
+        _idleCountdown = jmax(0, _idleCountdown - numFrames);
+}
+
+void Engine::updateRenderLoad(int64 startTicks, int numFrames)
+{
+    if (numFrames <= 0)
+        return;
+
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    const float load = float(elapsed * _sampleRate / numFrames);
+
+    auto& average = _renderLoad[isResampling() ? 1 : 0];
+    const float previous = average.load();
+    average = previous > 0.0f ? 0.99f * previous + 0.01f * load : load;
 }
 
 void Engine::setReverbWet(float v)
@@ -542,48 +1122,84 @@ bool Engine::isLimiterEnabled() const
     return _limiterEnabled;
 }
 
-void Engine::process(float* outL, float* outR, int numFrames, bool isNonRealtime)
+void Engine::process(float* outL, float* outR, int numFrames, const MidiBuffer& midiMessages, bool isNonRealtime)
 {
     jassert(outL != nullptr);
     jassert(outR != nullptr);
 
+    const auto startTicks = Time::getHighResolutionTicks();
+
     float* origOutL = outL;
     float* origOutR = outR;
     int origNumFrames = numFrames;
 
     processPendingIRSwitchEvents();
-    processPendingNoteEvents();
+
+    // The reverb tail has to expire as well.
+    if (canIdle(midiMessages) && (_reverbTailCounter == 0 || !_convolver.isAudible())) {
+        float* out[] = { outL, outR };
+        processIdle(out, 2, numFrames);
+        _reverbTailCounter = jmax(0, _reverbTailCounter - numFrames);
+        return;
+    }
+
+    _idle = false;
 
     bool wasAudioGenerated = false;
 
-    while (numFrames > 0)
-    {
-        if (_remainedSamples > 0)
+    if (isRenderingAhead()) {
+        float* out[] = { outL, outR };
+        wasAudioGenerated = pullRenderedAhead(out, 2, numFrames, midiMessages, isNonRealtime);
+    } else {
+        processPendingNoteEvents();
+
+        auto midiIt = midiMessages.cbegin();
+        const auto midiEnd = midiMessages.cend();
+
+        const bool resampling = isResampling();
+
+        while (numFrames > 0)
         {
-            const int idx = SUB_FRAME_LENGTH - _remainedSamples;
-            const float* subL = _subFrameBuffer.getReadPointer(0, idx);
-            const float* subR = _subFrameBuffer.getReadPointer(1, idx);
-
-            while (_remainedSamples > 0 && _interpolator.canWrite()) {
-                _interpolator.write(*subL, *subR);
-                --_remainedSamples;
-                subL += 1;
-                subR += 1;
+            if (resampling)
+            {
+                float* out[] = { outL, outR };
+                const int n = _resampler.read(out, 2, numFrames);
+
+                numFrames -= n;
+                outL += n;
+                outR += n;
+            }
+            else if (_remainedSamples > 0)
+            {
+                // Rendering at the host rate, sub-frames are copied as they are.
+                const int idx = SUB_FRAME_LENGTH - _remainedSamples;
+                const int n = jmin(_remainedSamples, numFrames);
+
+                memcpy(outL, _subFrameBuffer.getReadPointer(0, idx), sizeof(float) * (size_t)n);
+                memcpy(outR, _subFrameBuffer.getReadPointer(1, idx), sizeof(float) * (size_t)n);
+
+                _remainedSamples -= n;
+                numFrames -= n;
+                outL += n;
+                outR += n;
             }
 
-            while (numFrames > 0 && _interpolator.canRead()) {
-                _interpolator.read(*outL, *outR);
-                numFrames -= 1;
-                outL += 1;
-                outR += 1;
+            if ((resampling || _remainedSamples == 0) && numFrames > 0)
+            {
+                processMIDIMessagesUpTo(midiIt, midiEnd, origNumFrames - numFrames);
+                wasAudioGenerated |= processSubFrame();
+                jassert(_remainedSamples > 0);
+
+                if (resampling) {
+                    // The resampler takes the whole sub-frame at once.
+                    _resampler.write(_subFrameBuffer.getArrayOfReadPointers(), 2, SUB_FRAME_LENGTH);
+                    _remainedSamples = 0;
+                }
             }
         }
 
-        if (_remainedSamples == 0 && numFrames > 0)
-        {
-            wasAudioGenerated |= processSubFrame();
-            jassert(_remainedSamples > 0);
-        }
+        // Remaining messages will take effect on the next sub-frame.
+        processMIDIMessagesUpTo(midiIt, midiEnd, origNumFrames);
     }
 
     // When there is no audio generated we let the reverb tail to
@@ -598,70 +1214,95 @@ void Engine::process(float* outL, float* outR, int numFrames, bool isNonRealtime
         _convolver.process(origOutL, origOutR, origOutL, origOutR, origNumFrames);
     }
 
-    applyVolume(origOutL, origOutR, origNumFrames);
+    processMasterStage(origOutL, origOutR, origNumFrames);
 
-    // Apply limiter
-    if (_limiterEnabled) {
-        dsp::Limiter::process(_limiterSpec, _limiterState[0], origOutL, origOutL, origNumFrames);
-        dsp::Limiter::process(_limiterSpec, _limiterState[1], origOutR, origOutR, origNumFrames);
-    }
-
-    _volumeLevel.left.process(origOutL, origNumFrames);
-    _volumeLevel.right.process(origOutR, origNumFrames);
+    updateIdleCountdown(wasAudioGenerated, origNumFrames);
+    updateRenderLoad(startTicks, origNumFrames);
 }
 
-void Engine::process(AudioBuffer<float>& out, bool isNonRealtime)
+void Engine::process(AudioBuffer<float>& out, const MidiBuffer& midiMessages, bool isNonRealtime)
 {
-    ignoreUnused(isNonRealtime);
+    const auto startTicks = Time::getHighResolutionTicks();
 
     const int numChannels = out.getNumChannels();
     int numFrames = out.getNumSamples();
 
     processPendingIRSwitchEvents();
-    processPendingNoteEvents();
+
+    jassert(numChannels <= N_OUTPUT_CHANNELS);
+    float* outPtrs[N_OUTPUT_CHANNELS];
+
+    if (canIdle(midiMessages)) {
+        processIdle(out.getArrayOfWritePointers(), numChannels, numFrames);
+        return;
+    }
+
+    _idle = false;
 
     bool wasAudioGenerated = false;
 
-    int outIdx = 0;
+    if (isRenderingAhead()) {
+        for (int ch = 0; ch < numChannels; ++ch)
+            outPtrs[ch] = out.getWritePointer(ch);
 
-    while (numFrames > 0) {
-        int idx = SUB_FRAME_LENGTH - _remainedSamples;
+        wasAudioGenerated = pullRenderedAhead(outPtrs, numChannels, numFrames, midiMessages, isNonRealtime);
+    } else {
+        processPendingNoteEvents();
 
-        while (_remainedSamples > 0 && _interpolator.canWrite()) {
-            for (int ch = 0; ch < numChannels; ++ch)
-                _interpolator.writeUnchecked(_subFrameBuffer.getReadPointer(ch)[idx], (size_t) ch);
+        auto midiIt = midiMessages.cbegin();
+        const auto midiEnd = midiMessages.cend();
 
-            _interpolator.writeIncrement();
+        int outIdx = 0;
 
-            _remainedSamples -= 1;
-            idx += 1;
-        }
+        const bool resampling = isResampling();
 
-        while (numFrames > 0 && _interpolator.canRead()) {
-            for (int ch = 0; ch < numChannels; ++ch)
-                out.getWritePointer(ch)[outIdx] = _interpolator.readUnchecked(ch);
+        while (numFrames > 0) {
+            if (resampling) {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    outPtrs[ch] = out.getWritePointer(ch, outIdx);
 
-            _interpolator.readIncrement();
+                const int n = _resampler.read(outPtrs, (size_t)numChannels, numFrames);
 
-            numFrames -= 1;
-            outIdx += 1;
-        }
+                numFrames -= n;
+                outIdx += n;
+            } else {
+                // Rendering at the host rate, sub-frames are copied as they are.
+                const int idx = SUB_FRAME_LENGTH - _remainedSamples;
+                const int n = jmin(_remainedSamples, numFrames);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    out.copyFrom(ch, outIdx, _subFrameBuffer, ch, idx, n);
+
+                _remainedSamples -= n;
+                numFrames -= n;
+                outIdx += n;
+            }
+
+            if ((resampling || _remainedSamples == 0) && numFrames > 0)
+            {
+                processMIDIMessagesUpTo(midiIt, midiEnd, outIdx);
+                wasAudioGenerated |= processSubFrame();
+                jassert(_remainedSamples > 0);
+
+                if (resampling) {
+                    // The resampler takes the whole sub-frame at once.
+                    _resampler.write(_subFrameBuffer.getArrayOfReadPointers(), (size_t)numChannels, SUB_FRAME_LENGTH);
+                    _remainedSamples = 0;
+                }
+            }
 
-        if (_remainedSamples == 0 && numFrames > 0)
-        {
-            wasAudioGenerated |= processSubFrame();
-            jassert(_remainedSamples > 0);
         }
 
+        processMIDIMessagesUpTo(midiIt, midiEnd, out.getNumSamples());
     }
 
     // Multibus processing does not have a convolver FX
 
     // Global volume across all the buses
-    applyVolume(out);
+    processMasterStage(out);
 
-    _volumeLevel.left.process(out);
-    _volumeLevel.right = _volumeLevel.left;
+    updateIdleCountdown(wasAudioGenerated, out.getNumSamples());
+    updateRenderLoad(startTicks, out.getNumSamples());
 }
 
 void Engine::processMIDIMessage(const MidiMessage& message)
@@ -725,6 +1366,15 @@ void Engine::noteOff(int note, int midiChannel)
 }
 
 void Engine::allNotesOff()
+{
+    // Rendering ahead, the voices are released on the render thread.
+    if (isRenderingAhead())
+        _allNotesOffPending = true;
+    else
+        releaseAllNotes();
+}
+
+void Engine::releaseAllNotes()
 {
     for (auto* division : _divisions)
         division->allNotesOff();
@@ -977,6 +1627,22 @@ bool Engine::processSubFrame()
     return wasAudioGenerated;
 }
 
+void Engine::processMIDIMessagesUpTo(MidiBufferIterator& it, const MidiBufferIterator& end, int hostPosition)
+{
+    // Messages are snapped to the nearest sub-frame boundary.
+    const int limit = hostPosition + int(0.5f * _subFrameLengthHost);
+
+    while (it != end) {
+        const auto metadata = *it;
+
+        if (metadata.samplePosition > limit)
+            break;
+
+        processMIDIMessage(metadata.getMessage());
+        ++it;
+    }
+}
+
 void Engine::processPendingNoteEvents()
 {
     NoteEvent event;
@@ -992,14 +1658,16 @@ void Engine::processPendingNoteEvents()
 void Engine::processPendingIRSwitchEvents()
 {
     IRSwithEvent event;
-    bool received = false;
 
+    // Only the latest IR matters
     while (_irSwitchEvents.receive(event)) {
-        received = true;
+        _pendingIR = event.num;
     }
 
-    if (received) {
-        setReverbIR(event.num);
+    // The loader queue may be full, in which case the switch
+    // is retried on the next block rather than done here.
+    if (_pendingIR >= 0 && loadReverbIR(_pendingIR)) {
+        _pendingIR = -1;
     }
 }
 
@@ -1008,47 +1676,103 @@ void Engine::generateTremulant()
     float* buf = _tremulantBuffer.getWritePointer(0);
     jassert(buf != nullptr);
 
+    // Rotating phasor, set from the phase at each sub-frame
+    // so that the rounding errors do not build up.
+    const float cw = std::cos(_tremulantPhaseIncrement);
+    const float sw = std::sin(_tremulantPhaseIncrement);
+    float s = std::sin(_tremulantPhase);
+    float c = std::cos(_tremulantPhase);
+
     for (int i = 0; i < SUB_FRAME_LENGTH; ++i) {
-        const float s = sinf(_tremulantPhase);
         buf[i] = s * TREMULANT_LEVEL;
-        _tremulantPhase += TREMULANT_PHASE_INCREMENT;
 
-        if (_tremulantPhase >= juce::MathConstants<float>::twoPi)
-            _tremulantPhase -= juce::MathConstants<float>::twoPi;
+        const float sn = s * cw + c * sw;
+        c = c * cw - s * sw;
+        s = sn;
     }
+
+    _tremulantPhase = std::fmod(_tremulantPhase + SUB_FRAME_LENGTH * _tremulantPhaseIncrement,
+                                juce::MathConstants<float>::twoPi);
 }
 
-void Engine::applyVolume(AudioBuffer<float>& out)
+void Engine::applyVolume(float* const* out, int numChannels, int numFrames, float (*levels)[2])
 {
-    if (_params[VOLUME].isSmoothing()) {
-        for (int i = 0; i < out.getNumSamples(); ++i) {
-            const float g = _params[VOLUME].nextValue() * VOLUME_GAIN;
+    auto& volume = _params[VOLUME];
 
-            for (int ch = 0; ch < out.getNumChannels(); ++ch)
-                out.getWritePointer(ch)[i] *= g;
-        }
-    } else {
-        const float g = _params[VOLUME].target() * VOLUME_GAIN;
-        out.applyGain(g);
+    if (!volume.isSmoothing()) {
+        const float g = volume.target() * VOLUME_GAIN;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            simd::mul_const_levels(out[ch], g, (size_t)numFrames, levels[ch]);
+
+        return;
+    }
+
+    // The smoothed gain is tabulated by chunks, each applied to all the channels.
+    constexpr int chunkLength = 256;
+    float gain[chunkLength];
+
+    for (int offset = 0; offset < numFrames; offset += chunkLength) {
+        const int n = jmin(chunkLength, numFrames - offset);
+
+        volume.nextValues(gain, n);
+
+        for (int i = 0; i < n; ++i)
+            gain[i] *= VOLUME_GAIN;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            simd::mul_levels(out[ch] + offset, gain, (size_t)n, levels[ch]);
     }
 }
 
-void Engine::applyVolume(float* outL, float* outR, int numFrames)
+void Engine::processMasterStage(float* outL, float* outR, int numFrames)
 {
-    if (_params[VOLUME].isSmoothing()) {
-        for (int i = 0; i < numFrames; ++i) {
-            const float g = _params[VOLUME].nextValue() * VOLUME_GAIN;
-            outL[i] *= g;
-            outR[i] *= g;
-        }
-    } else {
-        const float g = _params[VOLUME].target() * VOLUME_GAIN;
+    if (numFrames <= 0)
+        return;
+
+    float* out[] = { outL, outR };
+    float levels[2][2] = {};
+
+    applyVolume(out, 2, numFrames, levels);
 
-        for (int i = 0; i < numFrames; ++i) {
-            outL[i] *= g;
-            outR[i] *= g;
+    // The limiter delays the audio even when disabled, so that the latency
+    // does not change. The levels are taken again if it reduced the gain.
+    if (_limiter.process(outL, outR, numFrames, !_limiterEnabled)) {
+        for (int ch = 0; ch < 2; ++ch) {
+            levels[ch][0] = 0.0f;
+            levels[ch][1] = 0.0f;
+            simd::mul_const_levels(out[ch], 1.0f, (size_t)numFrames, levels[ch]);
         }
     }
+
+    _volumeLevel.left.setLevels(levels[0][0], std::sqrt(levels[0][1] / numFrames));
+    _volumeLevel.right.setLevels(levels[1][0], std::sqrt(levels[1][1] / numFrames));
+}
+
+void Engine::processMasterStage(AudioBuffer<float>& out)
+{
+    const int numChannels = out.getNumChannels();
+    const int numFrames = out.getNumSamples();
+
+    if (numFrames <= 0)
+        return;
+
+    jassert(numChannels <= N_OUTPUT_CHANNELS);
+    float levels[N_OUTPUT_CHANNELS][2] = {};
+
+    applyVolume(out.getArrayOfWritePointers(), numChannels, numFrames, levels);
+
+    // Loudest of the buses
+    float peak = 0.0f;
+    float power = 0.0f;
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        peak = jmax(peak, levels[ch][0]);
+        power = jmax(power, levels[ch][1]);
+    }
+
+    _volumeLevel.left.setLevels(peak, std::sqrt(power / numFrames));
+    _volumeLevel.right = _volumeLevel.left;
 }
 
 void Engine::processControlMIDIMessage(const MidiMessage& message)
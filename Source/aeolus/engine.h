@@ -29,12 +29,15 @@
 #include "aeolus/sequencer.h"
 #include "aeolus/audioparam.h"
 #include "aeolus/levelmeter.h"
+#include "aeolus/renderahead.h"
+#include "aeolus/threading.h"
 #include "aeolus/dsp/convolver.h"
-#include "aeolus/dsp/interpolator.h"
 #include "aeolus/dsp/limiter.h"
+#include "aeolus/dsp/resampler.h"
 
 #include "mts/libMTSClient.h"
 
+#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -48,6 +51,7 @@ class Engine;
  * This class in a singleton which is shared among all the plugin instances.
  */
 class EngineGlobal : public juce::DeletedAtShutdown,
+                     public dsp::IRProvider,
                      private juce::Timer
 {
 public:
@@ -77,6 +81,7 @@ public:
 
     /**
      * Impulse response descriptor for IRs embedded as binary resources.
+     * The waveform is decoded on demand, see getIRWaveform().
      */
     struct IR
     {
@@ -88,9 +93,13 @@ public:
         bool zeroDelay;
         size_t startOffset; // Sample offset from the beginning of the IR waveform
 
-        juce::AudioBuffer<float> waveform;
+        int length;         // Waveform length in samples, known without decoding
+        float sampleRate;   // Waveform sample rate
     };
 
+    /// Memory budget of the decoded IR waveforms kept around (in bytes).
+    constexpr static size_t IRCacheBudget = 16 * 1024 * 1024;
+
     void loadSettings();
     void saveSettings();
 
@@ -101,10 +110,83 @@ public:
     Rankwave* getStopByName(const juce::String& name);
 
     const std::vector<IR>& getIRs() const noexcept { return _irs; }
+
+    /**
+     * Decoded IR waveform, by its index, resampled to the sample rate if needed.
+     * Recently used waveforms are cached, others are decoded here.
+     */
+    std::shared_ptr<const juce::AudioBuffer<float>> getIRWaveform(int index, float sampleRate) override;
     int getLongestIRLength() const noexcept { return _longestIRLength; }
 
+    /// Reverb IR spectra, shared by the engines. IRs are identified by their index.
+    dsp::IRSpectraCache& getIRSpectraCache() noexcept { return _irSpectraCache; }
+
     void updateStops(float sampleRate);
 
+    /**
+     * Build the wavetables for an engine about to play,
+     * and return the sample rate the engine must render at.
+     *
+     * This is the host rate in native sample rate mode, SAMPLE_RATE otherwise.
+     * Wavetables are shared though, so the other prepared engines rendering
+     * at another rate are rebuilt for this one (and will resample).
+     */
+    float prepareStops(const Engine& engine, float hostSampleRate);
+
+    /// Sample rate the wavetables are currently built for.
+    float getStopsSampleRate() const noexcept { return _sampleRate; }
+
+    /**
+     * Whether the engines render at the host sample rate,
+     * rather than at SAMPLE_RATE followed by resampling.
+     * @note This applies to the engines prepared afterwards.
+     */
+    bool isNativeSampleRate() const noexcept { return _nativeSampleRate; }
+    void setNativeSampleRate(bool shouldBeNative) noexcept { _nativeSampleRate = shouldBeNative; }
+
+    /**
+     * Quality of the conversion from the rendering rate to the host rate.
+     * @note This applies to the engines prepared afterwards.
+     */
+    dsp::Resampler::Quality getResamplingQuality() const noexcept { return _resamplingQuality; }
+    void setResamplingQuality(dsp::Resampler::Quality q) noexcept { _resamplingQuality = q; }
+
+    /**
+     * Number of sub-frames the engines render ahead of the audio callback
+     * on a dedicated thread, 0 to render in the callback. It is rounded
+     * up to a power of two, as only those are offered in the settings.
+     * @note This applies to the engines prepared afterwards.
+     */
+    int getRenderAheadSubFrames() const noexcept { return _renderAheadSubFrames; }
+    void setRenderAheadSubFrames(int n) noexcept { _renderAheadSubFrames = n > 0 ? juce::nextPowerOfTwo(juce::jmin(n, MaxRenderAheadSubFrames)) : 0; }
+
+    constexpr static int MaxRenderAheadSubFrames = 8;
+
+    /**
+     * Master limiter lookahead (in ms), which is its latency as well.
+     * It is rounded up to one of the lookaheads offered in the settings.
+     * @note This applies to the engines prepared afterwards.
+     */
+    int getLimiterLookahead() const noexcept { return _limiterLookahead; }
+    void setLimiterLookahead(int ms) noexcept;
+
+    constexpr static int MaxLimiterLookahead = 10;
+    constexpr static int DefaultLimiterLookahead = 2;
+
+    /**
+     * Decimation factor of the reverb late tail, 1 to convolve
+     * the whole IR at full rate (see dsp::Convolver::setHybrid()).
+     * It is rounded up to a power of two, as only those are offered in the settings.
+     * @note This applies to the engines prepared afterwards.
+     */
+    int getReverbTailDecimation() const noexcept { return _reverbTailDecimation; }
+    void setReverbTailDecimation(int n) noexcept { _reverbTailDecimation = juce::nextPowerOfTwo(juce::jlimit(1, MaxReverbTailDecimation, n)); }
+
+    constexpr static int MaxReverbTailDecimation = 4;
+
+    /// Rendering rates and processing load of the engines.
+    juce::String getRenderingReport();
+
     float getTuningFrequency() const noexcept { return _tuningFrequency; }
     void setTuningFrequency(float f) noexcept { _tuningFrequency = f; }
 
@@ -124,6 +206,20 @@ public:
 
     void rebuildRankwaves();
 
+    /// Scheduling policy of the threads doing real-time adjacent work (reverb).
+    const ThreadPolicy& getRealtimeThreadPolicy() const noexcept { return _realtimeThreadPolicy; }
+    void setRealtimeThreadPolicy(const ThreadPolicy& policy);
+
+    /// Number of reverb worker threads per engine, 0 for automatic.
+    int getRealtimeThreadsCount() const noexcept { return _realtimeThreadsCount; }
+
+    /// Scheduling policy of the threads doing bulk work (wavetables generation).
+    const ThreadPolicy& getBulkThreadPolicy() const noexcept { return _bulkThreadPolicy; }
+    void setBulkThreadPolicy(const ThreadPolicy& policy);
+
+    /// Description of the scheduling policies actually applied.
+    juce::String getThreadingReport();
+
     JUCE_DECLARE_SINGLETON (EngineGlobal, false)
 
 private:
@@ -132,6 +228,7 @@ private:
 
     void loadRankwaves();
     void loadIRs();
+    std::shared_ptr<juce::AudioBuffer<float>> decodeIR(const IR& ir, float sampleRate) const;
 
     /**
      * Refresh MTS tuning table for all MIDI notes.
@@ -139,6 +236,9 @@ private:
      */
     bool updateMTSTuningCache();
 
+    /// Called by the bulk pool jobs to make sure the policy is applied to the running thread.
+    void applyBulkThreadPolicy();
+
     // juce::Timer
     void timerCallback() override;
 
@@ -152,7 +252,18 @@ private:
     std::vector<IR> _irs;
     int _longestIRLength;   ///< Longest IR length in samples
 
-    float _sampleRate;
+    std::mutex _irWaveformsMutex;
+    std::vector<std::shared_ptr<const juce::AudioBuffer<float>>> _irWaveforms;
+    std::vector<float> _irWaveformsSampleRates;
+    std::vector<int> _irUsage;  ///< Decoded IRs, the most recently used last.
+    dsp::IRSpectraCache _irSpectraCache;
+
+    float _sampleRate{ SAMPLE_RATE_F };
+    bool _nativeSampleRate{ false };
+    dsp::Resampler::Quality _resamplingQuality{ dsp::Resampler::Medium };
+    int _renderAheadSubFrames{ 0 };
+    int _limiterLookahead{ DefaultLimiterLookahead };
+    int _reverbTailDecimation{ 1 };
     Scale _scale;
     float _tuningFrequency;
 
@@ -162,6 +273,16 @@ private:
 
     float _uiScalingFactor{ UI_SCALING_DEFAULT };
 
+    ThreadPolicy _realtimeThreadPolicy{};
+    int _realtimeThreadsCount{ 0 };
+
+    ThreadPolicy _bulkThreadPolicy{};
+    int _bulkThreadsCount{ 0 };
+    std::unique_ptr<juce::ThreadPool> _bulkThreadPool{};
+    std::mutex _bulkThreadPolicyMutex{};
+    std::atomic<int> _bulkThreadPolicyGeneration{ 0 };
+    juce::String _bulkAppliedThreadPolicy{ "normal" };
+
     juce::ApplicationProperties _globalProperties;
 };
 
@@ -190,6 +311,14 @@ public:
         int num;
     };
 
+    /// Short MIDI message queued for the render-ahead thread.
+    struct TimedMidiMessage
+    {
+        juce::int64 position;   ///< Host samples position it applies at.
+        juce::uint8 data[3];
+        int size;
+    };
+
     struct Level
     {
         LevelMeter left;
@@ -205,14 +334,33 @@ public:
     //--------------------------------------------------------------------------
 
     Engine();
+    ~Engine();
 
     /**
      * This method returns external processing sample rate as mandated
      * by the plugin host. Internally the organ engine performs processing
-     * with a fixed SAMPLE_RATE.
+     * with a fixed SAMPLE_RATE, unless rendering at the native rate.
      */
     float getSampleRate() const noexcept { return _sampleRate; }
 
+    /**
+     * Sample rate the voices are rendered at, before resampling to
+     * the host rate, see EngineGlobal::prepareStops().
+     */
+    float getRenderSampleRate() const noexcept { return _renderSampleRate; }
+
+    /// Whether the rendered audio has to be resampled to the host rate.
+    bool isResampling() const noexcept { return _renderSampleRate != _sampleRate; }
+
+    /// Whether prepareToPlay() has been called.
+    bool isPrepared() const noexcept { return _isPrepared; }
+
+    /**
+     * Rendering rate, and the processing load measured with
+     * and without resampling (to compare the two modes).
+     */
+    juce::String getRenderingReport() const;
+
     /**
      * Returns the number of active (playing) voices.
      */
@@ -223,9 +371,29 @@ public:
      */
     void prepareToPlay(float sampleRate, int frameSize);
 
+    /**
+     * Called by the host when the playback stops.
+     * This stops the render-ahead thread.
+     */
+    void releaseResources();
+
+    /**
+     * Prepare the engine to render at another rate, keeping the host rate.
+     * This is used when the shared wavetables are rebuilt for another engine.
+     * @note The audio processing must be suspended meanwhile.
+     */
+    void setRenderSampleRate(float renderSampleRate);
+
+    /// Whether sub-frames are rendered ahead of the audio callback.
+    bool isRenderingAhead() const noexcept { return _renderAhead.isRunning(); }
+
+    /// Latency added by rendering ahead, by the resampler filter and by the limiter lookahead (in host samples).
+    int getLatencySamples() const noexcept;
+
     /**
      * Set the reverb IR bu its number.
-     * @note This can be called upon initialisation or on the audio thread.
+     * @note This blocks until the IR spectra are computed, so this is
+     *       to be called upon initialisation only.
      */
     void setReverbIR(int num);
 
@@ -245,6 +413,22 @@ public:
      */
     float getReverbLengthInSeconds() const;
 
+    /**
+     * Apply global threads scheduling settings to the reverb worker.
+     * @param updateThreadsCount Whether to resize the worker threads pool as well.
+     */
+    void updateThreadPolicy(bool updateThreadsCount = false);
+
+    /**
+     * Returns the reverb worker threads policy actually applied.
+     */
+    juce::String getReverbThreadPolicy() const { return _convolver.getWorkerThreadPolicy(); }
+
+    /**
+     * Returns the reverb worker jobs statistics.
+     */
+    Worker::Stats getReverbWorkerStats() const noexcept { return _convolver.getWorkerStats(); }
+
     /**
      * Set reverb wet output level (linear).
      * @note This must be called on the audio thread.
@@ -294,11 +478,13 @@ public:
 
     /**
      * Generate audio.
+     * MIDI messages are applied at the sub-frame corresponding
+     * to their sample position within the block.
      */
-    void process(float* outL, float* outR, int numFrames, bool isNonRealtime = false);
+    void process(float* outL, float* outR, int numFrames, const juce::MidiBuffer& midiMessages, bool isNonRealtime = false);
 
     // Multibus version of the processing (does not include the convolver).
-    void process(juce::AudioBuffer<float>& out, bool isNonRealtime = false);
+    void process(juce::AudioBuffer<float>& out, const juce::MidiBuffer& midiMessages, bool isNonRealtime = false);
 
     /**
      * Process incoming MIDI messages.
@@ -348,15 +534,80 @@ private:
 
     bool processSubFrame();
 
+    /**
+     * Apply MIDI messages that fall before the next sub-frame.
+     * @param hostPosition Number of host samples already output in the current block.
+     */
+    void processMIDIMessagesUpTo(juce::MidiBufferIterator& it, const juce::MidiBufferIterator& end, int hostPosition);
+
     void processPendingNoteEvents();
     void processPendingIRSwitchEvents();
 
+    /// Start rendering ahead, if enabled in the global settings.
+    void startRenderAhead();
+
+    /// Render a sub-frame and push it to the render-ahead FIFO, on the render thread.
+    void renderAhead();
+
+    /**
+     * Pull the audio rendered ahead, and queue the block's MIDI messages
+     * to be rendered after the latency.
+     * @return Whether any audio has been generated since the previous call.
+     */
+    bool pullRenderedAhead(float* const* out, int numChannels, int numFrames,
+                           const juce::MidiBuffer& midiMessages, bool isNonRealtime);
+
+    /// Prepare the processing for the rate the voices are rendered at.
+    void prepareRendering(float renderSampleRate);
+
+    /// Apply the queued MIDI messages up to the host position, on the render thread.
+    void processRenderAheadMIDIMessagesUpTo(double position);
+
+    /// Release all the voices, on the thread rendering the sub-frames.
+    void releaseAllNotes();
+
+    /**
+     * Switch the reverb IR from the audio thread, with a crossfade.
+     * @return false if the convolver could not queue the request.
+     */
+    bool loadReverbIR(int num);
+
+    /// Set the convolver length for the IR, at the reverb sample rate.
+    void setReverbLength(const EngineGlobal::IR& ir);
+
+    /**
+     * Whether the block can be skipped altogether: nothing has sounded
+     * for a while, no key is held, and no event is waiting.
+     */
+    bool canIdle(const juce::MidiBuffer& midiMessages) const;
+
+    /// Output silence in place of the whole processing.
+    void processIdle(float* const* out, int numChannels, int numFrames);
+
+    /// Count the frames left to flush after the last generated audio.
+    void updateIdleCountdown(bool wasAudioGenerated, int numFrames);
+
+    /// Update the processing load of the current rendering mode.
+    void updateRenderLoad(juce::int64 startTicks, int numFrames);
+
     /// Generate tremulant osc waveform for a subframe.
     void generateTremulant();
 
-    /// Apply the gloval volume.
-    void applyVolume(juce::AudioBuffer<float>& out);
-    void applyVolume(float* outL, float* outR, int numFrames);
+    /**
+     * Apply the global volume, accumulating the levels of the result.
+     * @param levels Peak and sum of squares, per channel.
+     */
+    void applyVolume(float* const* out, int numChannels, int numFrames, float (*levels)[2]);
+
+    /**
+     * Master output stage: volume, limiter and levels metering.
+     * The levels are taken in the same pass as the volume, and the limiter
+     * only makes another pass over a channel when it actually engages.
+     */
+    void processMasterStage(float* outL, float* outR, int numFrames);
+
+    /// Multibus version of the master stage (there is no limiter).
+    void processMasterStage(juce::AudioBuffer<float>& out);
 
     /// Process control MIDI messages: program change (sequencer) and stop buttons CC.
     void processControlMIDIMessage(const juce::MidiMessage& message);
@@ -368,6 +619,18 @@ private:
     bool isKeySwitchBackward(int key) const;
 
     float _sampleRate;
+    float _renderSampleRate;
+    float _reverbSampleRate;    ///< Rate the reverb IR is resampled to.
+    std::atomic<bool> _isPrepared{ false };
+
+    /// Processing load (relative to real time) when rendering natively and when resampling.
+    std::array<std::atomic<float>, 2> _renderLoad{};
+
+    /// Sub-frame length expressed in host sample rate samples.
+    float _subFrameLengthHost;
+
+    /// Maximum number of samples per host processing block.
+    int _hostBlockSize;
 
     RingBuffer<NoteEvent, 1024> _pendingNoteEvents;
 
@@ -395,18 +658,22 @@ private:
 
     juce::AudioBuffer<float> _tremulantBuffer;
     float _tremulantPhase;
+    float _tremulantPhaseIncrement;
 
-    dsp::Limiter::Spec _limiterSpec;
-    std::array<dsp::Limiter::State, aeolus::N_OUTPUT_CHANNELS> _limiterState;
     dsp::Limiter _limiter;
     std::atomic<bool> _limiterEnabled{};
 
     dsp::Convolver _convolver;
     std::atomic<int> _selectedIR;
     RingBuffer<IRSwithEvent, 1024> _irSwitchEvents;
+    int _pendingIR;     ///< IR switch to be retried, -1 if none (audio thread only).
     int _reverbTailCounter;
 
-    dsp::Interpolator _interpolator;
+    dsp::Resampler _resampler;
+
+    int _idleHoldFrames;    ///< Frames to flush through the sub-frame, resampler and limiter before idling.
+    int _idleCountdown;     ///< Frames left before the engine may idle.
+    bool _idle;             ///< Whether the processing is currently skipped.
 
     juce::MidiKeyboardState _midiKeyboardState;
 
@@ -415,6 +682,17 @@ private:
     std::atomic<int> _midiControlChannelsMask;
     std::atomic<int> _midiSwellChannelsMask;
 
+    RingBuffer<TimedMidiMessage, 1024> _renderAheadMIDIMessages;
+    TimedMidiMessage _renderAheadHeldMessage{};     ///< Received but not due yet (render thread).
+    bool _hasRenderAheadHeldMessage{ false };
+    juce::int64 _renderAheadClock{ 0 };             ///< Host samples pulled (audio thread).
+    double _renderAheadPosition{ 0.0 };             ///< Host samples rendered (render thread).
+    juce::AudioBuffer<float> _renderAheadBuffer;    ///< Resampled sub-frame.
+    std::atomic<bool> _renderAheadAudioGenerated{ false };
+    std::atomic<bool> _allNotesOffPending{ false };
+
+    RenderAhead _renderAhead;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Engine)
 };
 
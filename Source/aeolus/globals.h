@@ -30,6 +30,11 @@
 #   define AEOLUS_MULTIBUS_OUTPUT 0
 #endif
 
+/// Sub-frame length option (must be set in the project configuration)
+#ifndef AEOLUS_SUB_FRAME_LENGTH
+#   define AEOLUS_SUB_FRAME_LENGTH 64
+#endif
+
 AEOLUS_NAMESPACE_BEGIN
 
 #if AEOLUS_MULTIBUS_OUTPUT
@@ -44,6 +49,7 @@ AEOLUS_NAMESPACE_BEGIN
 /// since there are not many harmonics to be generated
 /// and thus we can get away without using an interpolation filter
 /// when upsampling only.
+/// The engine may render at the host rate instead, see EngineGlobal::isNativeSampleRate().
 constexpr static int SAMPLE_RATE = 44100;
 constexpr static float SAMPLE_RATE_F = (float) SAMPLE_RATE;
 constexpr static float SAMPLE_RATE_R = 1.0f / SAMPLE_RATE_F;
@@ -73,16 +79,19 @@ constexpr static int TOTAL_NOTES = 128;
 constexpr static int MAX_RANK = 5;
 
 /// Length of a processing frame (in samples).
-constexpr static int SUB_FRAME_LENGTH = 64;
+constexpr static int SUB_FRAME_LENGTH = AEOLUS_SUB_FRAME_LENGTH;
+
+// The pipes attack length gets aligned on the sub-frame length.
+static_assert((SUB_FRAME_LENGTH & (SUB_FRAME_LENGTH - 1)) == 0, "Sub-frame length must be a power of two");
+static_assert(SUB_FRAME_LENGTH >= 32 && SUB_FRAME_LENGTH <= 256, "Sub-frame length must be within 32..256 samples");
 
 /// Tremulant modulation frequency.
 constexpr static float TREMULANT_FREQUENCY = 6.283184f;
-constexpr static float TREMULANT_PHASE_INCREMENT = juce::MathConstants<float>::twoPi * TREMULANT_FREQUENCY / SAMPLE_RATE;
 
 /// Tremulant OSC wavetable amplitude.
 constexpr static float TREMULANT_LEVEL = 1.0f;
 constexpr static float TREMULANT_TARGET_LEVEL = 0.5f; // Amplitude modulation level.
-constexpr static size_t TREMULANT_DELAY_LENGTH = 32; // Frequency modulation delay line length (in samples).
+constexpr static size_t TREMULANT_DELAY_LENGTH = 32; // Frequency modulation delay line length (in samples at SAMPLE_RATE).
 constexpr static float TREMULANT_DELAY_MODULATION_LEVEL = 0.9f; // Frequency modulation level.
 
 /// Number of steps in the sequencer.
@@ -43,6 +43,13 @@ public:
     void process(const juce::AudioBuffer<float>& buffer, int channel);
     void process(float* const buffer, int size);
 
+    /// Publish levels measured elsewhere (like in the master stage).
+    void setLevels(float peak, float rms) noexcept
+    {
+        _peak = peak;
+        _rms = rms;
+    }
+
 private:
     std::atomic<float> _peak;
     std::atomic<float> _rms;
@@ -204,7 +204,9 @@ void Pipewave::play(Pipewave::State& state, float* out)
             }
         } else {
             float y = state.playInterpolation;
-            state.playInterpolationSpeed += _instability * 0.0005f * (0.05f * _instability * (rnd.nextFloat() - 0.5f) - state.playInterpolationSpeed);
+            // Pitch drift is updated once per sub-frame, at the rate tuned for 64-sample sub-frames.
+            constexpr float driftRate = 0.0005f * float(SUB_FRAME_LENGTH) / 64.0f;
+            state.playInterpolationSpeed += _instability * driftRate * (0.05f * _instability * (rnd.nextFloat() - 0.5f) - state.playInterpolationSpeed);
             float dy = state.playInterpolationSpeed * _sampleStep;
 
             while (k--) {
@@ -485,7 +487,7 @@ void Rankwave::retunePipes(const Scale& scale, float tuningFrequency)
             Pipewave* pipe = _pipes[nextPipeSetIndex][i - _noteMin];
 
             // @note MTS tuning may return some weird frequencies, we need to clamp them
-            const float f{ jlimit(0.1f, SAMPLE_RATE * 0.5f - 0.1f, g->getMTSNoteToFrequency(i) * fnd) };
+            const float f{ jlimit(0.1f, g->getStopsSampleRate() * 0.5f - 0.1f, g->getMTSNoteToFrequency(i) * fnd) };
 
             if (pipe->getPipeFrequency() != f) {
                 pipe->setFrequency(f);
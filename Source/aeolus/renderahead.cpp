@@ -0,0 +1,249 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "aeolus/renderahead.h"
+#include "aeolus/sema.h"
+
+#include <thread>
+
+using namespace juce;
+
+AEOLUS_NAMESPACE_BEGIN
+
+struct RenderAhead::Impl
+{
+    AbstractFifo fifo;
+    AudioBuffer<float> buffer;
+    int targetFrames;
+
+    RenderFunction render;
+    ThreadPolicy policy;
+
+    LightweightSemaphore sema;
+    std::atomic_bool running;
+    std::thread thread;
+
+    std::atomic<uint64_t> underruns;
+    std::atomic<int> framesToDrop;  ///< Frames output as silence, the render thread has yet to drop.
+
+    LightweightSemaphore readerSema;
+    std::atomic_bool readerWaiting;
+
+    Impl()
+        : fifo{1}
+        , buffer{}
+        , targetFrames{0}
+        , render{}
+        , policy{}
+        , sema(0)
+        , running{false}
+        , thread{}
+        , underruns{0}
+        , framesToDrop{0}
+        , readerSema(0, 0)
+        , readerWaiting{false}
+    {
+    }
+
+    ~Impl()
+    {
+        stop();
+    }
+
+    void run()
+    {
+        policy.applyToCurrentThread();
+
+        while (running) {
+            if (fifo.getNumReady() < targetFrames)
+                render();
+            else
+                sema.wait();
+        }
+    }
+
+    void start(int numChannels, int target, int maxRenderFrames, const ThreadPolicy& p, RenderFunction fn)
+    {
+        jassert(numChannels > 0);
+        jassert(target > 0);
+        jassert(maxRenderFrames > 0);
+
+        stop();
+
+        // The render thread stops below the target, so that a whole
+        // render call always fits (one slot of the FIFO is never used).
+        fifo.setTotalSize(target + maxRenderFrames + 1);
+        buffer.setSize(numChannels, fifo.getTotalSize());
+        buffer.clear();
+
+        targetFrames = target;
+        render = std::move(fn);
+        policy = p;
+        underruns = 0;
+        framesToDrop = 0;
+
+        running = true;
+        thread = std::thread(&Impl::run, this);
+    }
+
+    void stop()
+    {
+        if (thread.joinable()) {
+            running = false;
+            sema.notify();
+            thread.join();
+        }
+
+        fifo.reset();
+    }
+
+    void write(const float* const* data, int numChannels, int numFrames)
+    {
+        jassert(numChannels <= buffer.getNumChannels());
+        jassert(numFrames <= fifo.getFreeSpace());
+
+        // These frames have been output as silence already. Only this thread
+        // decreases the count, so what is loaded here can be taken away.
+        const int skip = jmin(numFrames, framesToDrop.load(std::memory_order_acquire));
+
+        if (skip > 0) {
+            framesToDrop.fetch_sub(skip, std::memory_order_relaxed);
+            numFrames -= skip;
+        }
+
+        {
+            const auto scope = fifo.write(numFrames);
+
+            for (int ch = 0; ch < numChannels; ++ch) {
+                if (scope.blockSize1 > 0)
+                    buffer.copyFrom(ch, scope.startIndex1, data[ch] + skip, scope.blockSize1);
+
+                if (scope.blockSize2 > 0)
+                    buffer.copyFrom(ch, scope.startIndex2, data[ch] + skip + scope.blockSize1, scope.blockSize2);
+            }
+        }
+
+        // Pairs with the fence in waitForFrames().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (readerWaiting.load(std::memory_order_relaxed))
+            readerSema.notify();
+    }
+
+    /// Sleep until the frames are rendered (they may not exceed the target).
+    void waitForFrames(int numFrames)
+    {
+        numFrames = jmin(numFrames, targetFrames);
+
+        readerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        while (running && fifo.getNumReady() < numFrames)
+            readerSema.wait();
+
+        readerWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    int read(float* const* out, int numChannels, int numFrames, bool waitForMissingFrames)
+    {
+        jassert(numChannels <= buffer.getNumChannels());
+
+        if (fifo.getNumReady() < numFrames) {
+            // The render thread is behind, make sure it is not sleeping.
+            sema.notify();
+
+            if (waitForMissingFrames)
+                waitForFrames(numFrames);
+        }
+
+        const int n = jmin(numFrames, fifo.getNumReady());
+
+        {
+            const auto scope = fifo.read(n);
+
+            for (int ch = 0; ch < numChannels; ++ch) {
+                if (scope.blockSize1 > 0)
+                    FloatVectorOperations::copy(out[ch], buffer.getReadPointer(ch, scope.startIndex1), scope.blockSize1);
+
+                if (scope.blockSize2 > 0)
+                    FloatVectorOperations::copy(out[ch] + scope.blockSize1, buffer.getReadPointer(ch, scope.startIndex2), scope.blockSize2);
+            }
+        }
+
+        if (n < numFrames) {
+            for (int ch = 0; ch < numChannels; ++ch)
+                FloatVectorOperations::clear(out[ch] + n, numFrames - n);
+
+            // The late frames are dropped by the render thread, to keep the latency.
+            framesToDrop.fetch_add(numFrames - n, std::memory_order_release);
+            ++underruns;
+        }
+
+        // Let the render thread refill the FIFO.
+        sema.notify();
+
+        return n;
+    }
+};
+
+//==============================================================================
+
+RenderAhead::RenderAhead()
+    : d{std::make_unique<Impl>()}
+{
+}
+
+RenderAhead::~RenderAhead() = default;
+
+void RenderAhead::start(int numChannels, int targetFrames, int maxRenderFrames, const ThreadPolicy& policy, RenderFunction render)
+{
+    d->start(numChannels, targetFrames, maxRenderFrames, policy, std::move(render));
+}
+
+void RenderAhead::stop()
+{
+    d->stop();
+}
+
+bool RenderAhead::isRunning() const noexcept
+{
+    return d->running;
+}
+
+int RenderAhead::getTargetFrames() const noexcept
+{
+    return d->targetFrames;
+}
+
+uint64_t RenderAhead::getNumUnderruns() const noexcept
+{
+    return d->underruns;
+}
+
+void RenderAhead::write(const float* const* data, int numChannels, int numFrames)
+{
+    d->write(data, numChannels, numFrames);
+}
+
+int RenderAhead::read(float* const* out, int numChannels, int numFrames, bool waitForFrames)
+{
+    return d->read(out, numChannels, numFrames, waitForFrames);
+}
+
+AEOLUS_NAMESPACE_END
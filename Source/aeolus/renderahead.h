@@ -0,0 +1,99 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2025 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "aeolus/globals.h"
+#include "aeolus/threading.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+AEOLUS_NAMESPACE_BEGIN
+
+/**
+ * @brief Audio rendered ahead of the audio callback on a dedicated thread.
+ *
+ * The render thread keeps a lock-free FIFO filled up to a target number
+ * of frames, by calling the render function which pushes what it renders
+ * with write(). The audio callback pulls the frames with read(), which
+ * wakes the render thread up to render the next ones.
+ *
+ * The target level is the latency this adds. When the render thread falls
+ * behind, read() outputs the missing frames as silence (this counts as
+ * an underrun), and the render thread drops as many frames from what it
+ * renders next, so that the latency gets back to the target.
+ */
+class RenderAhead final
+{
+public:
+
+    /// Render some frames and push them with write(), called on the render thread.
+    using RenderFunction = std::function<void()>;
+
+    RenderAhead();
+    ~RenderAhead();
+    RenderAhead(const RenderAhead&) = delete;
+    RenderAhead& operator = (const RenderAhead&) = delete;
+
+    /**
+     * Start the render thread.
+     *
+     * @param numChannels Number of channels in the FIFO.
+     * @param targetFrames Number of frames to keep rendered ahead.
+     * @param maxRenderFrames Largest number of frames a single render call pushes.
+     * @param policy Scheduling policy of the render thread.
+     * @param render Render function.
+     *
+     * @note This allocates, and must not be called while processing.
+     */
+    void start(int numChannels, int targetFrames, int maxRenderFrames, const ThreadPolicy& policy, RenderFunction render);
+
+    /// Stop the render thread, discarding the frames rendered ahead.
+    void stop();
+
+    bool isRunning() const noexcept;
+
+    /// Number of frames kept rendered ahead, i.e. the added latency.
+    int getTargetFrames() const noexcept;
+
+    /// Number of read() calls that could not deliver all the frames in time.
+    uint64_t getNumUnderruns() const noexcept;
+
+    /// Push rendered frames, on the render thread only.
+    void write(const float* const* data, int numChannels, int numFrames);
+
+    /**
+     * Pull frames, on the audio thread only.
+     *
+     * @param out Channels to write to, channels not rendered are cleared.
+     * @param waitForFrames Whether to wait for the missing frames (offline rendering),
+     *                      rather than output them as silence.
+     * @return Number of frames actually rendered in time.
+     */
+    int read(float* const* out, int numChannels, int numFrames, bool waitForFrames);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> d;
+};
+
+AEOLUS_NAMESPACE_END
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "aeolus/globals.h"
+#include <algorithm>
 #include <atomic>
 
 AEOLUS_NAMESPACE_BEGIN
@@ -29,7 +30,13 @@ AEOLUS_NAMESPACE_BEGIN
  *
  * This is an implementation of single-producer single-consumer queue.
  *
- * @note From http://www.vitorian.com/x1/archives/370
+ * The producer and consumer indices live on separate cache lines, each
+ * side keeping a local copy of the opposite index so that the shared one
+ * is only re-read when the queue looks full (or empty). The indices run
+ * freely and are wrapped with a mask, hence the size must be a power of two.
+ * All Size slots are usable.
+ *
+ * @note Originally based on http://www.vitorian.com/x1/archives/370
  * https://github.com/Vitorian/RedditHelp/blob/master/test_spsc_ring.cpp
  */
 template <typename T, size_t Size>
@@ -37,9 +44,15 @@ class RingBuffer final
 {
 public:
 
+    static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "Ring buffer size must be a power of two");
+
+    constexpr static size_t capacity = Size;
+
     RingBuffer() noexcept
-        : readIdx {0},
-          writeIdx {0},
+        : writeIdx {0},
+          cachedReadIdx {0},
+          readIdx {0},
+          cachedWriteIdx {0},
           data {{}}
     {
     }
@@ -49,44 +62,119 @@ public:
 
     ~RingBuffer() = default;
 
+    /// Push a single item (producer side).
     bool send (const T& obj) noexcept
     {
-        size_t nextIdx = writeIdx + 1 < Size ? writeIdx + 1 : 0;
+        const size_t w = writeIdx.load (std::memory_order_relaxed);
 
-        if (nextIdx != readIdx)
+        if (w - cachedReadIdx == Size)
         {
-            data[writeIdx] = obj;
-            writeIdx = nextIdx;
-            return true;
+            cachedReadIdx = readIdx.load (std::memory_order_acquire);
+
+            if (w - cachedReadIdx == Size)
+                return false;
         }
 
-        return false;
+        data[w & mask] = obj;
+        writeIdx.store (w + 1, std::memory_order_release);
+        return true;
     }
 
+    /**
+     * Push up to n items (producer side).
+     * The items are published at once.
+     * @return Number of items actually sent.
+     */
+    size_t sendN (const T* objs, size_t n) noexcept
+    {
+        const size_t w = writeIdx.load (std::memory_order_relaxed);
+        size_t space = Size - (w - cachedReadIdx);
+
+        if (space < n)
+        {
+            cachedReadIdx = readIdx.load (std::memory_order_acquire);
+            space = Size - (w - cachedReadIdx);
+        }
+
+        n = std::min (n, space);
+
+        for (size_t i = 0; i < n; ++i)
+            data[(w + i) & mask] = objs[i];
+
+        if (n > 0)
+            writeIdx.store (w + n, std::memory_order_release);
+
+        return n;
+    }
+
+    /// Pop a single item (consumer side).
     bool receive (T& obj) noexcept
     {
-        size_t nextIdx = readIdx + 1 < Size ? readIdx + 1 : 0;
+        const size_t r = readIdx.load (std::memory_order_relaxed);
 
-        if (readIdx != writeIdx)
+        if (r == cachedWriteIdx)
         {
-            obj = std::move (data[readIdx]);
-            readIdx = nextIdx;
-            return true;
+            cachedWriteIdx = writeIdx.load (std::memory_order_acquire);
+
+            if (r == cachedWriteIdx)
+                return false;
         }
 
-        return false;
+        obj = std::move (data[r & mask]);
+        readIdx.store (r + 1, std::memory_order_release);
+        return true;
     }
 
+    /**
+     * Pop up to n items (consumer side).
+     * @return Number of items actually received.
+     */
+    size_t receiveN (T* objs, size_t n) noexcept
+    {
+        const size_t r = readIdx.load (std::memory_order_relaxed);
+        size_t avail = cachedWriteIdx - r;
+
+        if (avail < n)
+        {
+            cachedWriteIdx = writeIdx.load (std::memory_order_acquire);
+            avail = cachedWriteIdx - r;
+        }
+
+        n = std::min (n, avail);
+
+        for (size_t i = 0; i < n; ++i)
+            objs[i] = std::move (data[(r + i) & mask]);
+
+        if (n > 0)
+            readIdx.store (r + n, std::memory_order_release);
+
+        return n;
+    }
+
+    /// Number of items in the queue (approximate when called concurrently).
     size_t count() const noexcept
     {
-        return (writeIdx - readIdx) % Size;
+        const size_t r = readIdx.load (std::memory_order_acquire);
+        const size_t w = writeIdx.load (std::memory_order_acquire);
+        return w - r;
     }
 
+    bool isEmpty() const noexcept { return count() == 0; }
+
 private:
 
-    std::atomic<size_t> readIdx;
-    std::atomic<size_t> writeIdx;
-    T data[Size];
+    constexpr static size_t mask = Size - 1;
+    constexpr static size_t cacheLineSize = 64;
+
+    // Producer-owned
+    alignas(cacheLineSize) std::atomic<size_t> writeIdx;
+    size_t cachedReadIdx;
+
+    // Consumer-owned
+    alignas(cacheLineSize) std::atomic<size_t> readIdx;
+    size_t cachedWriteIdx;
+
+    alignas(cacheLineSize) T data[Size];
 };
 
 AEOLUS_NAMESPACE_END
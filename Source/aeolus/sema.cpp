@@ -19,6 +19,27 @@
 
 #include "aeolus/sema.h"
 
+#include <algorithm>
+
+#if defined(_WIN32)
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#elif defined(__APPLE__)
+#   include <dispatch/dispatch.h>
+#else
+#   include <semaphore.h>
+#   include <cerrno>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   include <immintrin.h>
+#endif
+
 AEOLUS_NAMESPACE_BEGIN
 
 Semaphore::Semaphore(unsigned initialCount)
@@ -63,4 +84,106 @@ unsigned Semaphore::count() const
     return _counter;
 }
 
+//==============================================================================
+
+namespace {
+
+inline void cpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+} // anonymous namespace
+
+struct LightweightSemaphore::OsSemaphore
+{
+#if defined(_WIN32)
+
+    HANDLE handle;
+
+    OsSemaphore()   { handle = CreateSemaphoreW(nullptr, 0, MAXLONG, nullptr); jassert(handle != nullptr); }
+    ~OsSemaphore()  { CloseHandle(handle); }
+    void post()     { ReleaseSemaphore(handle, 1, nullptr); }
+    void wait()     { WaitForSingleObject(handle, INFINITE); }
+
+#elif defined(__APPLE__)
+
+    dispatch_semaphore_t sema;
+
+    OsSemaphore()   { sema = dispatch_semaphore_create(0); jassert(sema != nullptr); }
+    ~OsSemaphore()  { dispatch_release(sema); }
+    void post()     { dispatch_semaphore_signal(sema); }
+    void wait()     { dispatch_semaphore_wait(sema, DISPATCH_TIME_FOREVER); }
+
+#else
+
+    sem_t sema;
+
+    OsSemaphore()   { [[maybe_unused]] const int rc = sem_init(&sema, 0, 0); jassert(rc == 0); }
+    ~OsSemaphore()  { sem_destroy(&sema); }
+    void post()     { sem_post(&sema); }
+
+    void wait()
+    {
+        int rc;
+
+        do {
+            rc = sem_wait(&sema);
+        } while (rc != 0 && errno == EINTR);
+    }
+
+#endif
+};
+
+LightweightSemaphore::LightweightSemaphore(int initialCount, int spinCount)
+    : _counter{initialCount}
+    , _spinCount{spinCount}
+    , _os{std::make_unique<OsSemaphore>()}
+{
+    jassert(initialCount >= 0);
+}
+
+LightweightSemaphore::~LightweightSemaphore() = default;
+
+void LightweightSemaphore::notify() noexcept
+{
+    // Negative count means there are threads sleeping on the OS semaphore.
+    if (_counter.fetch_add(1, std::memory_order_release) < 0)
+        _os->post();
+}
+
+void LightweightSemaphore::wait() noexcept
+{
+    for (int i = 0; i < _spinCount; ++i) {
+        if (tryWait())
+            return;
+
+        cpuRelax();
+    }
+
+    if (_counter.fetch_sub(1, std::memory_order_acquire) <= 0)
+        _os->wait();
+}
+
+bool LightweightSemaphore::tryWait() noexcept
+{
+    int c = _counter.load(std::memory_order_relaxed);
+
+    while (c > 0) {
+        if (_counter.compare_exchange_weak(c, c - 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+    }
+
+    return false;
+}
+
+int LightweightSemaphore::count() const noexcept
+{
+    return std::max(0, _counter.load(std::memory_order_relaxed));
+}
+
 AEOLUS_NAMESPACE_END
@@ -21,6 +21,8 @@
 
 #include "aeolus/globals.h"
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 
@@ -49,4 +51,41 @@ private:
     unsigned _counter;
 };
 
+/**
+ * @brief Lock-free counting semaphore.
+ *
+ * The count is kept in an atomic, so notify() never takes a lock:
+ * it is a single atomic increment, and only when a thread is
+ * actually sleeping it also posts the OS semaphore (which does not block).
+ * The waiting side spins for a short while before going to sleep,
+ * which keeps the wake-up latency low under steady load.
+ *
+ * This is meant to signal a worker thread from the audio thread.
+ */
+class LightweightSemaphore final
+{
+public:
+
+    /// Number of spin iterations before waiting on the OS semaphore.
+    constexpr static int DefaultSpinCount = 4096;
+
+    explicit LightweightSemaphore(int initialCount = 0, int spinCount = DefaultSpinCount);
+    ~LightweightSemaphore();
+    LightweightSemaphore(const LightweightSemaphore&) = delete;
+    LightweightSemaphore& operator =(const LightweightSemaphore&) = delete;
+
+    void notify() noexcept;
+    void wait() noexcept;
+    bool tryWait() noexcept;
+    int count() const noexcept;
+
+private:
+
+    struct OsSemaphore;
+
+    std::atomic<int> _counter;
+    int _spinCount;
+    std::unique_ptr<OsSemaphore> _os;
+};
+
 AEOLUS_NAMESPACE_END
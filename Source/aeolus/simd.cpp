@@ -19,6 +19,8 @@
 
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 #include "aeolus/simd.h"
 
 #ifdef SIMD
@@ -140,8 +142,10 @@ namespace no_simd {
     void complex_mul(float* res, const float* a, const float* b, size_t size)
     {
         for (size_t i = 0; i < size; i += 2) {
-            res[i] = a[i] * b[i] - a[i + 1]* b[i + 1];
-            res[i + 1] = a[i] * b[i + 1] + a[i + 1] * b[i];
+            const float x = a[i] * b[i] - a[i + 1] * b[i + 1];
+            const float y = a[i] * b[i + 1] + a[i + 1] * b[i];
+            res[i] = x;
+            res[i + 1] = y;
         }
     }
 
@@ -155,6 +159,14 @@ namespace no_simd {
         }
     }
 
+    void complex_mul_add(float* res, const float* a, const float* b, size_t size)
+    {
+        for (size_t i = 0; i < size; i += 2) {
+            res[i] += a[i] * b[i] - a[i + 1] * b[i + 1];
+            res[i + 1] += a[i] * b[i + 1] + a[i + 1] * b[i];
+        }
+    }
+
     void fft_step(float* data, const float* w, size_t n)
     {
         for (unsigned i = 0; i < n; i += 2) {
@@ -167,6 +179,103 @@ namespace no_simd {
         }
     }
 
+    void mul_levels(float* out, const float* gain, size_t size, float* levels)
+    {
+        float peak = levels[0];
+        float power = levels[1];
+
+        for (size_t i = 0; i < size; ++i) {
+            const float y = out[i] * gain[i];
+            out[i] = y;
+            peak = std::max(peak, std::abs(y));
+            power += y * y;
+        }
+
+        levels[0] = peak;
+        levels[1] = power;
+    }
+
+    void mul_const_levels(float* out, const float k, size_t size, float* levels)
+    {
+        float peak = levels[0];
+        float power = levels[1];
+
+        for (size_t i = 0; i < size; ++i) {
+            const float y = out[i] * k;
+            out[i] = y;
+            peak = std::max(peak, std::abs(y));
+            power += y * y;
+        }
+
+        levels[0] = peak;
+        levels[1] = power;
+    }
+
+    float max_abs(const float* in, size_t size)
+    {
+        float peak = 0.0f;
+
+        for (size_t i = 0; i < size; ++i)
+            peak = std::max(peak, std::abs(in[i]));
+
+        return peak;
+    }
+
+    void max_shifted(float* out, const float* in, size_t shift, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = std::max(in[i], in[i + shift]);
+    }
+
+    void mul(float* out, const float* gain, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] *= gain[i];
+    }
+
+    // The ramp is computed from the index rather than accumulated,
+    // so that the vectorized versions give the same values.
+    void mul_ramp(float* out, float start, float step, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] *= start + step * float(i + 1);
+    }
+
+    void mul_ramp_add(float* out, const float* in, float start, float step, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] += in[i] * (start + step * float(i + 1));
+    }
+
+    void biquad8(float* data, size_t numFrames, float* bank)
+    {
+        const float* b0 = &bank[0];
+        const float* b1 = &bank[8];
+        const float* b2 = &bank[16];
+        const float* a1 = &bank[24];
+        const float* a2 = &bank[32];
+        float* x1 = &bank[40];
+        float* x2 = &bank[48];
+        float* y1 = &bank[56];
+        float* y2 = &bank[64];
+
+        for (size_t i = 0; i < numFrames; ++i) {
+            float* frame = &data[i * 8];
+
+            for (size_t k = 0; k < 8; ++k) {
+                const float x = frame[k];
+                const float y = b0[k] * x + b1[k] * x1[k] + b2[k] * x2[k] - a1[k] * y1[k] - a2[k] * y2[k];
+
+                x2[k] = x1[k];
+                x1[k] = x;
+                y2[k] = y1[k];
+                y1[k] = y;
+
+                frame[k] = y;
+            }
+        }
+    }
+
 } // namespace no_simd
 
 //------------------------------------------------------------------------------
@@ -327,6 +436,30 @@ namespace sse {
         }
     }
 
+    void complex_mul_add(float* res, const float* a, const float* b, size_t size)
+    {
+        assert ((size & 0x3) == 0);
+        __m128 factors = _mm_set_ps (1.0f, -1.0f, 1.0f, -1.0f);
+
+        for (size_t i = 0; i < size; i += 4) {
+            __m128 a01 = _mm_load_ps ((const float*)&a[i]); // [a0.r, a0.i, a1.r, a1.i]
+            __m128 b01 = _mm_load_ps ((const float*)&b[i]); // [b0.r, b0.i, b1.r, b1.i]
+
+            __m128 b01r = _mm_shuffle_ps (b01, b01, 0xA0); // [b0.r, b0.r, b1.r, b1.r]
+            __m128 b01i = _mm_shuffle_ps (b01, b01, 0xF5); // [b0.i, b0.i, b1.i, b1.i]
+
+            __m128 a01ir = _mm_shuffle_ps (a01, a01, 0xB1); // [a0.i, a0.r, a1.i, a1.r]
+
+            __m128 r0 = _mm_mul_ps (a01, b01r);
+            __m128 r3 = _mm_mul_ps (a01ir, b01i);
+            r3 = _mm_mul_ps (r3, factors);
+            r3 = _mm_add_ps (r0, r3);                // a * b
+
+            r0 = _mm_load_ps ((const float*)&res[i]);
+            _mm_store_ps ((float*)&res[i], _mm_add_ps (r0, r3));
+        }
+    }
+
     void fft_step(float* data, const float* w, size_t n)
     {
         assert ((n & 0x3) == 0);
@@ -362,6 +495,171 @@ namespace sse {
         }
     }
 
+    // Fold the vector levels into the running ones.
+    static inline void reduce_levels(__m128 vpeak, __m128 vpower, float* levels)
+    {
+        alignas (16) float peak[4];
+        alignas (16) float power[4];
+
+        _mm_store_ps (peak, vpeak);
+        _mm_store_ps (power, vpower);
+
+        levels[0] = std::max({ levels[0], peak[0], peak[1], peak[2], peak[3] });
+        levels[1] += (power[0] + power[1]) + (power[2] + power[3]);
+    }
+
+    void mul_levels(float* out, const float* gain, size_t size, float* levels)
+    {
+        const __m128 sign = _mm_set1_ps (-0.0f);
+        __m128 vpeak = _mm_setzero_ps ();
+        __m128 vpower = _mm_setzero_ps ();
+
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4) {
+            __m128 y = _mm_mul_ps (_mm_loadu_ps (&out[i]), _mm_loadu_ps (&gain[i]));
+            _mm_storeu_ps (&out[i], y);
+            vpeak = _mm_max_ps (vpeak, _mm_andnot_ps (sign, y));
+            vpower = _mm_add_ps (vpower, _mm_mul_ps (y, y));
+        }
+
+        reduce_levels (vpeak, vpower, levels);
+        no_simd::mul_levels (&out[n], &gain[n], size - n, levels);
+    }
+
+    void mul_const_levels(float* out, const float k, size_t size, float* levels)
+    {
+        const __m128 sign = _mm_set1_ps (-0.0f);
+        const __m128 kv = _mm_set1_ps (k);
+        __m128 vpeak = _mm_setzero_ps ();
+        __m128 vpower = _mm_setzero_ps ();
+
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4) {
+            __m128 y = _mm_mul_ps (_mm_loadu_ps (&out[i]), kv);
+            _mm_storeu_ps (&out[i], y);
+            vpeak = _mm_max_ps (vpeak, _mm_andnot_ps (sign, y));
+            vpower = _mm_add_ps (vpower, _mm_mul_ps (y, y));
+        }
+
+        reduce_levels (vpeak, vpower, levels);
+        no_simd::mul_const_levels (&out[n], k, size - n, levels);
+    }
+
+    float max_abs(const float* in, size_t size)
+    {
+        const __m128 sign = _mm_set1_ps (-0.0f);
+        __m128 vpeak = _mm_setzero_ps ();
+
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4)
+            vpeak = _mm_max_ps (vpeak, _mm_andnot_ps (sign, _mm_loadu_ps (&in[i])));
+
+        alignas (16) float peak[4];
+        _mm_store_ps (peak, vpeak);
+
+        return std::max({ peak[0], peak[1], peak[2], peak[3], no_simd::max_abs (&in[n], size - n) });
+    }
+
+    void max_shifted(float* out, const float* in, size_t shift, size_t size)
+    {
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4)
+            _mm_storeu_ps (&out[i], _mm_max_ps (_mm_loadu_ps (&in[i]), _mm_loadu_ps (&in[i + shift])));
+
+        no_simd::max_shifted (&out[n], &in[n], shift, size - n);
+    }
+
+    void mul(float* out, const float* gain, size_t size)
+    {
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4)
+            _mm_storeu_ps (&out[i], _mm_mul_ps (_mm_loadu_ps (&out[i]), _mm_loadu_ps (&gain[i])));
+
+        no_simd::mul (&out[n], &gain[n], size - n);
+    }
+
+    void mul_ramp(float* out, float start, float step, size_t size)
+    {
+        const __m128 vstart = _mm_set1_ps (start);
+        const __m128 vstep = _mm_set1_ps (step);
+        const __m128 four = _mm_set1_ps (4.0f);
+        __m128 index = _mm_setr_ps (1.0f, 2.0f, 3.0f, 4.0f);
+
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4) {
+            const __m128 g = _mm_add_ps (vstart, _mm_mul_ps (vstep, index));
+            _mm_storeu_ps (&out[i], _mm_mul_ps (_mm_loadu_ps (&out[i]), g));
+            index = _mm_add_ps (index, four);
+        }
+
+        for (size_t i = n; i < size; ++i)
+            out[i] *= start + step * float(i + 1);
+    }
+
+    void mul_ramp_add(float* out, const float* in, float start, float step, size_t size)
+    {
+        const __m128 vstart = _mm_set1_ps (start);
+        const __m128 vstep = _mm_set1_ps (step);
+        const __m128 four = _mm_set1_ps (4.0f);
+        __m128 index = _mm_setr_ps (1.0f, 2.0f, 3.0f, 4.0f);
+
+        const size_t n = size - (size % 4);
+
+        for (size_t i = 0; i < n; i += 4) {
+            const __m128 g = _mm_add_ps (vstart, _mm_mul_ps (vstep, index));
+            const __m128 y = _mm_add_ps (_mm_loadu_ps (&out[i]), _mm_mul_ps (_mm_loadu_ps (&in[i]), g));
+            _mm_storeu_ps (&out[i], y);
+            index = _mm_add_ps (index, four);
+        }
+
+        for (size_t i = n; i < size; ++i)
+            out[i] += in[i] * (start + step * float(i + 1));
+    }
+
+    void biquad8(float* data, size_t numFrames, float* bank)
+    {
+        // Two groups of four filters
+        for (size_t g = 0; g < 8; g += 4) {
+            const __m128 b0 = _mm_loadu_ps (&bank[g]);
+            const __m128 b1 = _mm_loadu_ps (&bank[g + 8]);
+            const __m128 b2 = _mm_loadu_ps (&bank[g + 16]);
+            const __m128 a1 = _mm_loadu_ps (&bank[g + 24]);
+            const __m128 a2 = _mm_loadu_ps (&bank[g + 32]);
+            __m128 x1 = _mm_loadu_ps (&bank[g + 40]);
+            __m128 x2 = _mm_loadu_ps (&bank[g + 48]);
+            __m128 y1 = _mm_loadu_ps (&bank[g + 56]);
+            __m128 y2 = _mm_loadu_ps (&bank[g + 64]);
+
+            for (size_t i = 0; i < numFrames; ++i) {
+                float* frame = &data[i * 8 + g];
+                const __m128 x = _mm_loadu_ps (frame);
+
+                __m128 y = _mm_add_ps (_mm_mul_ps (b0, x), _mm_mul_ps (b1, x1));
+                y = _mm_add_ps (y, _mm_mul_ps (b2, x2));
+                y = _mm_sub_ps (y, _mm_mul_ps (a1, y1));
+                y = _mm_sub_ps (y, _mm_mul_ps (a2, y2));
+
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+
+                _mm_storeu_ps (frame, y);
+            }
+
+            _mm_storeu_ps (&bank[g + 40], x1);
+            _mm_storeu_ps (&bank[g + 48], x2);
+            _mm_storeu_ps (&bank[g + 56], y1);
+            _mm_storeu_ps (&bank[g + 64], y2);
+        }
+    }
+
 #if SIMD_FMA
     namespace fma {
 
@@ -478,6 +776,31 @@ namespace sse {
             }
         }
 
+        void complex_mul_add(float* res, const float* a, const float* b, size_t size)
+        {
+            assert ((size & 0x3) == 0);
+            __m128 factors = _mm_set_ps (1.0f, -1.0f, 1.0f, -1.0f);
+
+            for (size_t i = 0; i < size; i += 4) {
+                __m128 a01 = _mm_load_ps ((const float*)&a[i]); // [a0.r, a0.i, a1.r, a1.i]
+                __m128 b01 = _mm_load_ps ((const float*)&b[i]); // [b0.r, b0.i, b1.r, b1.i]
+
+                __m128 b01r = _mm_shuffle_ps (b01, b01, 0xA0); // [b0.r, b0.r, b1.r, b1.r]
+                __m128 b01i = _mm_shuffle_ps (b01, b01, 0xF5); // [b0.i, b0.i, b1.i, b1.i]
+
+                __m128 a01ir = _mm_shuffle_ps (a01, a01, 0xB1); // [a0.i, a0.r, a1.i, a1.r]
+
+                __m128 r0 = _mm_mul_ps (a01, b01r);
+                __m128 r3 = _mm_mul_ps (a01ir, b01i);
+                r3 = _mm_fmadd_ps (r3, factors, r0);     // a * b
+
+                r0 = _mm_load_ps ((const float*)&res[i]);
+                r3 = _mm_add_ps (r0, r3);                // res + a * b
+
+                _mm_store_ps ((float*)&res[i], r3);
+            }
+        }
+
         void fft_step(float* data, const float* w, size_t n)
         {
             assert ((n & 0x3) == 0);
@@ -726,6 +1049,41 @@ namespace avx {
         _mm256_zeroupper();
     }
 
+    void complex_mul_add(float* res, const float* a, const float* b, size_t size)
+    {
+        if (size < 8) {
+            sse::complex_mul_add (res, a, b, size);
+            return;
+        }
+
+        assert ((size & 0x7) == 0);
+        assert (is_aligned (res, 32));
+        assert (is_aligned (a, 32));
+        assert (is_aligned (b, 32));
+
+        __m256 factors = _mm256_set_ps (1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+
+        for (size_t i = 0; i < size; i += 8) {
+            __m256 a01 = _mm256_load_ps ((const float*)&a[i]);
+            __m256 b01 = _mm256_load_ps ((const float*)&b[i]);
+
+            __m256 b01r = _mm256_shuffle_ps (b01, b01, 0xA0);
+            __m256 b01i = _mm256_shuffle_ps (b01, b01, 0xF5);
+
+            __m256 a01ir = _mm256_shuffle_ps (a01, a01, 0xB1);
+
+            __m256 r0 = _mm256_mul_ps (a01, b01r);
+            __m256 r3 = _mm256_mul_ps (a01ir, b01i);
+            r3 = _mm256_mul_ps (r3, factors);
+            r3 = _mm256_add_ps (r0, r3);                // a * b
+
+            r0 = _mm256_load_ps ((const float*)&res[i]);
+            _mm256_store_ps ((float*)&res[i], _mm256_add_ps (r0, r3));
+        }
+
+        _mm256_zeroupper();
+    }
+
     void fft_step(float* data, const float* w, size_t n)
     {
         assert ((n & 0x7) == 0);
@@ -763,6 +1121,177 @@ namespace avx {
         _mm256_zeroupper();
     }
 
+    static inline void reduce_levels(__m256 vpeak, __m256 vpower, float* levels)
+    {
+        sse::reduce_levels (_mm_max_ps (_mm256_castps256_ps128 (vpeak), _mm256_extractf128_ps (vpeak, 1)),
+                            _mm_add_ps (_mm256_castps256_ps128 (vpower), _mm256_extractf128_ps (vpower, 1)),
+                            levels);
+    }
+
+    void mul_levels(float* out, const float* gain, size_t size, float* levels)
+    {
+        const __m256 sign = _mm256_set1_ps (-0.0f);
+        __m256 vpeak = _mm256_setzero_ps ();
+        __m256 vpower = _mm256_setzero_ps ();
+
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 y = _mm256_mul_ps (_mm256_loadu_ps (&out[i]), _mm256_loadu_ps (&gain[i]));
+            _mm256_storeu_ps (&out[i], y);
+            vpeak = _mm256_max_ps (vpeak, _mm256_andnot_ps (sign, y));
+            vpower = _mm256_add_ps (vpower, _mm256_mul_ps (y, y));
+        }
+
+        reduce_levels (vpeak, vpower, levels);
+        _mm256_zeroupper();
+
+        no_simd::mul_levels (&out[n], &gain[n], size - n, levels);
+    }
+
+    void mul_const_levels(float* out, const float k, size_t size, float* levels)
+    {
+        const __m256 sign = _mm256_set1_ps (-0.0f);
+        const __m256 kv = _mm256_set1_ps (k);
+        __m256 vpeak = _mm256_setzero_ps ();
+        __m256 vpower = _mm256_setzero_ps ();
+
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8) {
+            __m256 y = _mm256_mul_ps (_mm256_loadu_ps (&out[i]), kv);
+            _mm256_storeu_ps (&out[i], y);
+            vpeak = _mm256_max_ps (vpeak, _mm256_andnot_ps (sign, y));
+            vpower = _mm256_add_ps (vpower, _mm256_mul_ps (y, y));
+        }
+
+        reduce_levels (vpeak, vpower, levels);
+        _mm256_zeroupper();
+
+        no_simd::mul_const_levels (&out[n], k, size - n, levels);
+    }
+
+    float max_abs(const float* in, size_t size)
+    {
+        const __m256 sign = _mm256_set1_ps (-0.0f);
+        __m256 vpeak = _mm256_setzero_ps ();
+
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8)
+            vpeak = _mm256_max_ps (vpeak, _mm256_andnot_ps (sign, _mm256_loadu_ps (&in[i])));
+
+        alignas (16) float peak[4];
+        _mm_store_ps (peak, _mm_max_ps (_mm256_castps256_ps128 (vpeak), _mm256_extractf128_ps (vpeak, 1)));
+        _mm256_zeroupper();
+
+        return std::max({ peak[0], peak[1], peak[2], peak[3], no_simd::max_abs (&in[n], size - n) });
+    }
+
+    void max_shifted(float* out, const float* in, size_t shift, size_t size)
+    {
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8)
+            _mm256_storeu_ps (&out[i], _mm256_max_ps (_mm256_loadu_ps (&in[i]), _mm256_loadu_ps (&in[i + shift])));
+
+        _mm256_zeroupper();
+
+        no_simd::max_shifted (&out[n], &in[n], shift, size - n);
+    }
+
+    void mul(float* out, const float* gain, size_t size)
+    {
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8)
+            _mm256_storeu_ps (&out[i], _mm256_mul_ps (_mm256_loadu_ps (&out[i]), _mm256_loadu_ps (&gain[i])));
+
+        _mm256_zeroupper();
+
+        no_simd::mul (&out[n], &gain[n], size - n);
+    }
+
+    void mul_ramp(float* out, float start, float step, size_t size)
+    {
+        const __m256 vstart = _mm256_set1_ps (start);
+        const __m256 vstep = _mm256_set1_ps (step);
+        const __m256 eight = _mm256_set1_ps (8.0f);
+        __m256 index = _mm256_setr_ps (1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8) {
+            const __m256 g = _mm256_add_ps (vstart, _mm256_mul_ps (vstep, index));
+            _mm256_storeu_ps (&out[i], _mm256_mul_ps (_mm256_loadu_ps (&out[i]), g));
+            index = _mm256_add_ps (index, eight);
+        }
+
+        _mm256_zeroupper();
+
+        for (size_t i = n; i < size; ++i)
+            out[i] *= start + step * float(i + 1);
+    }
+
+    void mul_ramp_add(float* out, const float* in, float start, float step, size_t size)
+    {
+        const __m256 vstart = _mm256_set1_ps (start);
+        const __m256 vstep = _mm256_set1_ps (step);
+        const __m256 eight = _mm256_set1_ps (8.0f);
+        __m256 index = _mm256_setr_ps (1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+
+        const size_t n = size - (size % 8);
+
+        for (size_t i = 0; i < n; i += 8) {
+            const __m256 g = _mm256_add_ps (vstart, _mm256_mul_ps (vstep, index));
+            const __m256 y = _mm256_add_ps (_mm256_loadu_ps (&out[i]), _mm256_mul_ps (_mm256_loadu_ps (&in[i]), g));
+            _mm256_storeu_ps (&out[i], y);
+            index = _mm256_add_ps (index, eight);
+        }
+
+        _mm256_zeroupper();
+
+        for (size_t i = n; i < size; ++i)
+            out[i] += in[i] * (start + step * float(i + 1));
+    }
+
+    void biquad8(float* data, size_t numFrames, float* bank)
+    {
+        const __m256 b0 = _mm256_loadu_ps (&bank[0]);
+        const __m256 b1 = _mm256_loadu_ps (&bank[8]);
+        const __m256 b2 = _mm256_loadu_ps (&bank[16]);
+        const __m256 a1 = _mm256_loadu_ps (&bank[24]);
+        const __m256 a2 = _mm256_loadu_ps (&bank[32]);
+        __m256 x1 = _mm256_loadu_ps (&bank[40]);
+        __m256 x2 = _mm256_loadu_ps (&bank[48]);
+        __m256 y1 = _mm256_loadu_ps (&bank[56]);
+        __m256 y2 = _mm256_loadu_ps (&bank[64]);
+
+        for (size_t i = 0; i < numFrames; ++i) {
+            float* frame = &data[i * 8];
+            const __m256 x = _mm256_loadu_ps (frame);
+
+            __m256 y = _mm256_add_ps (_mm256_mul_ps (b0, x), _mm256_mul_ps (b1, x1));
+            y = _mm256_add_ps (y, _mm256_mul_ps (b2, x2));
+            y = _mm256_sub_ps (y, _mm256_mul_ps (a1, y1));
+            y = _mm256_sub_ps (y, _mm256_mul_ps (a2, y2));
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+
+            _mm256_storeu_ps (frame, y);
+        }
+
+        _mm256_storeu_ps (&bank[40], x1);
+        _mm256_storeu_ps (&bank[48], x2);
+        _mm256_storeu_ps (&bank[56], y1);
+        _mm256_storeu_ps (&bank[64], y2);
+
+        _mm256_zeroupper();
+    }
+
     namespace fma {
 #if SIMD_FMA
         void mul_const_add(float* out, const float* in, const float k, size_t size)
@@ -918,6 +1447,42 @@ namespace avx {
             _mm256_zeroupper();
         }
 
+        void complex_mul_add(float* res, const float* a, const float* b, size_t size)
+        {
+            if (size < 8) {
+                sse::complex_mul_add (res, a, b, size);
+                return;
+            }
+
+            assert ((size & 0x7) == 0);
+            assert (is_aligned (res, 32));
+            assert (is_aligned (a, 32));
+            assert (is_aligned (b, 32));
+
+            __m256 factors = _mm256_set_ps (1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+
+            for (size_t i = 0; i < size; i += 8) {
+                __m256 a01 = _mm256_load_ps ((const float*)&a[i]);
+                __m256 b01 = _mm256_load_ps ((const float*)&b[i]);
+
+                __m256 b01r = _mm256_shuffle_ps (b01, b01, 0xA0);
+                __m256 b01i = _mm256_shuffle_ps (b01, b01, 0xF5);
+
+                __m256 a01ir = _mm256_shuffle_ps (a01, a01, 0xB1);
+
+                __m256 r0 = _mm256_mul_ps (a01, b01r);
+                __m256 r3 = _mm256_mul_ps (a01ir, b01i);
+                r3 = _mm256_fmadd_ps (r3, factors, r0);     // a * b
+
+                r0 = _mm256_load_ps ((const float*)&res[i]);
+                r3 = _mm256_add_ps (r0, r3);                // res + a * b
+
+                _mm256_store_ps ((float*)&res[i], r3);
+            }
+
+            _mm256_zeroupper();
+        }
+
         void fft_step(float* data, const float* w, size_t n)
         {
             assert ((n & 0x7) == 0);
@@ -970,7 +1535,16 @@ float (*simd::mul_reduce)(const float*, const float*, size_t)               = &n
 float (*simd::mul_reduce_unaligned)(const float*, const float*, size_t)     = &no_simd::mul_reduce;
 void  (*simd::complex_mul)(float*, const float*, const float*, size_t)      = &no_simd::complex_mul;
 void  (*simd::complex_mul_conj)(float*, const float*, const float*, size_t) = &no_simd::complex_mul_conj;
+void  (*simd::complex_mul_add)(float*, const float*, const float*, size_t)      = &no_simd::complex_mul_add;
 void  (*simd::fft_step)(float*, const float*, size_t)                       = &no_simd::fft_step;
+void  (*simd::mul_levels)(float*, const float*, size_t, float*)             = &no_simd::mul_levels;
+void  (*simd::mul_const_levels)(float*, const float, size_t, float*)       = &no_simd::mul_const_levels;
+float (*simd::max_abs)(const float*, size_t)                                = &no_simd::max_abs;
+void  (*simd::max_shifted)(float*, const float*, size_t, size_t)            = &no_simd::max_shifted;
+void  (*simd::mul)(float*, const float*, size_t)                            = &no_simd::mul;
+void  (*simd::mul_ramp)(float*, float, float, size_t)                       = &no_simd::mul_ramp;
+void  (*simd::mul_ramp_add)(float*, const float*, float, float, size_t)     = &no_simd::mul_ramp_add;
+void  (*simd::biquad8)(float*, size_t, float*)                              = &no_simd::biquad8;
 
 #ifdef SIMD
 
@@ -987,7 +1561,16 @@ static const bool simd_map = []() -> bool {
         simd::mul_reduce_unaligned = &sse::mul_reduce_unaligned;
         simd::complex_mul          = &sse::complex_mul;
         simd::complex_mul_conj     = &sse::complex_mul_conj;
+        simd::complex_mul_add      = &sse::complex_mul_add;
         simd::fft_step             = &sse::fft_step;
+        simd::mul_levels           = &sse::mul_levels;
+        simd::mul_const_levels     = &sse::mul_const_levels;
+        simd::max_abs              = &sse::max_abs;
+        simd::max_shifted          = &sse::max_shifted;
+        simd::mul                  = &sse::mul;
+        simd::mul_ramp             = &sse::mul_ramp;
+        simd::mul_ramp_add         = &sse::mul_ramp_add;
+        simd::biquad8              = &sse::biquad8;
 
 #if SIMD_FMA
         if (cpu.fma) {
@@ -996,6 +1579,7 @@ static const bool simd_map = []() -> bool {
             simd::mul_reduce_unaligned = &sse::fma::mul_reduce_unaligned;
             simd::complex_mul          = &sse::fma::complex_mul;
             simd::complex_mul_conj     = &sse::fma::complex_mul_conj;
+            simd::complex_mul_add      = &sse::fma::complex_mul_add;
             simd::fft_step             = &sse::fma::fft_step;
         }
 #endif // SIMD_FMA
@@ -1011,7 +1595,16 @@ static const bool simd_map = []() -> bool {
         simd::mul_reduce_unaligned = &avx::mul_reduce_unaligned;
         simd::complex_mul          = &avx::complex_mul;
         simd::complex_mul_conj     = &avx::complex_mul_conj;
+        simd::complex_mul_add      = &avx::complex_mul_add;
         simd::fft_step             = &avx::fft_step;
+        simd::mul_levels           = &avx::mul_levels;
+        simd::mul_const_levels     = &avx::mul_const_levels;
+        simd::max_abs              = &avx::max_abs;
+        simd::max_shifted          = &avx::max_shifted;
+        simd::mul                  = &avx::mul;
+        simd::mul_ramp             = &avx::mul_ramp;
+        simd::mul_ramp_add         = &avx::mul_ramp_add;
+        simd::biquad8              = &avx::biquad8;
 
 #if SIMD_FMA
         if (cpu.fma) {
@@ -1020,6 +1613,7 @@ static const bool simd_map = []() -> bool {
             simd::mul_reduce_unaligned = &avx::fma::mul_reduce_unaligned;
             simd::complex_mul          = &avx::fma::complex_mul;
             simd::complex_mul_conj     = &avx::fma::complex_mul_conj;
+            simd::complex_mul_add      = &avx::fma::complex_mul_add;
             simd::fft_step             = &avx::fma::fft_step;
         }
 #endif // SIMD_FMA
@@ -67,7 +67,32 @@ struct simd
     static float (*mul_reduce_unaligned)(const float*, const float*, size_t);
     static void  (*complex_mul)(float*, const float*, const float*, size_t);
     static void  (*complex_mul_conj)(float*, const float*, const float*, size_t);
+    static void  (*complex_mul_add)(float*, const float*, const float*, size_t);
     static void  (*fft_step)(float*, const float*, size_t);
+
+    // Apply a gain (per sample or constant) in place, and accumulate the levels
+    // of the result: levels[0] is the running peak, levels[1] the sum of squares.
+    // These accept unaligned pointers and any size.
+    static void  (*mul_levels)(float*, const float*, size_t, float*);
+    static void  (*mul_const_levels)(float*, const float, size_t, float*);
+
+    // Peak of a buffer, and the maximum of a buffer and itself shifted
+    // (out[i] = max(in[i], in[i + shift])). Unaligned, any size.
+    static float (*max_abs)(const float*, size_t);
+    static void  (*max_shifted)(float*, const float*, size_t, size_t);
+
+    // Per sample gain in place (out[i] *= gain[i]), and gains ramping linearly
+    // as start + (i + 1) * step, applied in place or added: out[i] += in[i] * ramp[i].
+    // Unaligned, any size.
+    static void  (*mul)(float*, const float*, size_t);
+    static void  (*mul_ramp)(float*, float, float, size_t);
+    static void  (*mul_ramp_add)(float*, const float*, float, float, size_t);
+
+    // Eight independent biquads in place, the samples being interleaved by filter
+    // (data[i * 8 + k] for filter k). The bank holds 9 rows of 8 floats:
+    // b0, b1, b2, a1, a2 followed by the x1, x2, y1, y2 states, which are updated.
+    // Unaligned, any number of frames.
+    static void  (*biquad8)(float*, size_t, float*);
 };
 
 AEOLUS_NAMESPACE_END
\ No newline at end of file
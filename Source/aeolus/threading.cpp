@@ -0,0 +1,232 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2021 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#include "aeolus/threading.h"
+
+#if JUCE_WINDOWS
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <sched.h>
+#   include <cerrno>
+#endif
+
+using namespace juce;
+
+AEOLUS_NAMESPACE_BEGIN
+
+namespace {
+
+String applyScheduling(ThreadPolicy::Scheduling scheduling, int priority)
+{
+    const auto name = ThreadPolicy::getSchedulingName(scheduling);
+
+#if JUCE_WINDOWS
+
+    // The thread may be running with a raised priority from a previous policy.
+    if (scheduling == ThreadPolicy::Normal) {
+        if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL) == 0)
+            return "unchanged (normal failed)";
+
+        return name;
+    }
+
+    // Windows has no real-time policies as such, use the highest priorities instead.
+    const int winPriority = scheduling == ThreadPolicy::Fifo ? THREAD_PRIORITY_TIME_CRITICAL
+                                                             : THREAD_PRIORITY_HIGHEST;
+
+    if (SetThreadPriority(GetCurrentThread(), winPriority) == 0)
+        return "normal (" + name + " failed)";
+
+    return scheduling == ThreadPolicy::Fifo ? "time-critical" : "highest";
+
+#else
+
+    // The thread may be running real-time from a previous policy.
+    if (scheduling == ThreadPolicy::Normal) {
+        sched_param param{};
+        param.sched_priority = 0;
+
+        if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0)
+            return "unchanged (normal failed)";
+
+        return name;
+    }
+
+    const int policy = scheduling == ThreadPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+
+    sched_param param{};
+    param.sched_priority = jlimit(sched_get_priority_min(policy), sched_get_priority_max(policy), priority);
+
+    const int rc = pthread_setschedparam(pthread_self(), policy, &param);
+
+    if (rc == EPERM)
+        return "normal (" + name + " not permitted)";
+
+    if (rc != 0)
+        return "normal (" + name + " failed)";
+
+    return name + " " + String(param.sched_priority);
+
+#endif
+}
+
+String applyAffinity(const String& affinity)
+{
+    const auto cpus = ThreadPolicy::parseCpuList(affinity);
+    const auto cpusStr = affinity.removeCharacters(" ");
+
+#if JUCE_WINDOWS
+
+    if (cpus.empty()) {
+        // Unpin a thread pinned by a previous policy.
+        DWORD_PTR processMask = 0;
+        DWORD_PTR systemMask = 0;
+
+        if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) == 0
+            || SetThreadAffinityMask(GetCurrentThread(), processMask) == 0)
+            return ", CPUs unchanged (unpinning failed)";
+
+        return {};
+    }
+
+    DWORD_PTR mask = 0;
+
+    for (int cpu : cpus) {
+        if (cpu < (int)(8 * sizeof(DWORD_PTR)))
+            mask |= DWORD_PTR(1) << cpu;
+    }
+
+    if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+        return ", any CPU (pinning to " + cpusStr + " failed)";
+
+    return ", CPUs " + cpusStr;
+
+#elif JUCE_LINUX || JUCE_BSD
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpus.empty()) {
+        // Unpin a thread pinned by a previous policy, the kernel drops the CPUs not available.
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &set);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            return ", CPUs unchanged (unpinning failed)";
+
+        return {};
+    }
+
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        return ", any CPU (pinning to " + cpusStr + " failed)";
+
+    return ", CPUs " + cpusStr;
+
+#else
+
+    // macOS only offers affinity hints, which do not pin threads.
+    if (cpus.empty())
+        return {};
+
+    return ", any CPU (pinning not supported)";
+
+#endif
+}
+
+} // anonymous namespace
+
+bool ThreadPolicy::operator == (const ThreadPolicy& other) const noexcept
+{
+    return scheduling == other.scheduling
+        && priority == other.priority
+        && affinity == other.affinity;
+}
+
+String ThreadPolicy::applyToCurrentThread() const
+{
+    return applyScheduling(scheduling, priority) + applyAffinity(affinity);
+}
+
+String ThreadPolicy::getSchedulingName(Scheduling s)
+{
+    switch (s) {
+    case Normal:     return "normal";
+    case RoundRobin: return "SCHED_RR";
+    case Fifo:       return "SCHED_FIFO";
+    default:         break;
+    }
+
+    return "unknown";
+}
+
+std::vector<int> ThreadPolicy::parseCpuList(const String& str)
+{
+    std::vector<int> cpus;
+
+    // Ids beyond the CPUs present are rejected, which also keeps ranges bounded.
+    const int64 numCpus = SystemStats::getNumCpus();
+
+    StringArray tokens;
+    tokens.addTokens(str, ",", {});
+    tokens.trim();
+    tokens.removeEmptyStrings();
+
+    for (const auto& token : tokens) {
+        if (!token.containsOnly("0123456789-"))
+            continue;
+
+        if (token.contains("-")) {
+            const auto fromStr = token.upToFirstOccurrenceOf("-", false, false);
+            const auto toStr = token.fromFirstOccurrenceOf("-", false, false);
+
+            if (fromStr.isEmpty() || toStr.isEmpty() || toStr.contains("-"))
+                continue;
+
+            const int64 from = fromStr.getLargeIntValue();
+            const int64 to = toStr.getLargeIntValue();
+
+            if (from < 0 || from > to || to >= numCpus)
+                continue;
+
+            for (int cpu = (int) from; cpu <= (int) to; ++cpu)
+                cpus.push_back(cpu);
+        } else {
+            const int64 cpu = token.getLargeIntValue();
+
+            if (cpu >= 0 && cpu < numCpus)
+                cpus.push_back((int) cpu);
+        }
+    }
+
+    return cpus;
+}
+
+AEOLUS_NAMESPACE_END
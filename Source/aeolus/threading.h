@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------------
+//
+//  Copyright (C) 2021 Arthur Benilov <arthur.benilov@gmail.com>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "aeolus/globals.h"
+
+#include <vector>
+
+AEOLUS_NAMESPACE_BEGIN
+
+/**
+ * @brief Scheduling policy of the engine side threads.
+ *
+ * Real-time scheduling usually requires special privileges
+ * (e.g. rtprio limits on Linux). When it cannot be granted
+ * the thread keeps its normal scheduling, and this is
+ * reflected in the description returned by applyToCurrentThread().
+ */
+struct ThreadPolicy
+{
+    enum Scheduling
+    {
+        Normal = 0,
+        RoundRobin,     ///< SCHED_RR
+        Fifo,           ///< SCHED_FIFO
+
+        NumSchedulings
+    };
+
+    constexpr static int MinPriority = 1;
+    constexpr static int MaxPriority = 99;
+    constexpr static int DefaultPriority = 70;
+
+    Scheduling scheduling{Normal};
+    int priority{DefaultPriority};  ///< Real-time priority, only used with RoundRobin and Fifo.
+    juce::String affinity{};        ///< CPUs to run on, e.g. "2,3" or "4-7", empty to run on any.
+
+    bool operator == (const ThreadPolicy& other) const noexcept;
+    bool operator != (const ThreadPolicy& other) const noexcept { return !operator == (other); }
+
+    /**
+     * Apply this policy to the calling thread.
+     * @return Description of the actually applied policy.
+     */
+    juce::String applyToCurrentThread() const;
+
+    static juce::String getSchedulingName(Scheduling s);
+
+    /// Parse CPUs list like "0,2,4-7".
+    static std::vector<int> parseCpuList(const juce::String& str);
+};
+
+AEOLUS_NAMESPACE_END
@@ -42,13 +42,16 @@ void Voice::trigger(const Pipewave::State& state)
     jassert(_state.isIdle());
     _state = state;
 
+    const float sampleRate = _engine.getRenderSampleRate();
+
     // Chiff
     const auto freq = _state.pipewave->getPipeFrequency();
     const auto dt = 1.0f / freq;
 
     // Delay pipe harmonic signal so that chiff noise builds up first
-    _delay = (int) jmin((float)_delayLine.size(), 0.5f * dt * SAMPLE_RATE_F);
+    _delay = (int) jmin((float)_delayLine.size(), 0.5f * dt * sampleRate);
 
+    _chiff.setSampleRate(sampleRate);
     _chiff.setAttack(5.0f * dt);
     _chiff.setDecay(100.0f * dt);
     _chiff.setSustain(0.01f);
@@ -74,7 +77,7 @@ void Voice::trigger(const Pipewave::State& state)
     float n = k * float(abs(note - 65)); // ~[-30..30]
     _panPosition = jlimit(0.0f, 1.0f, (n + 30.0f) / 60.0f);
 
-    _spatialSource.setSampleRate(SAMPLE_RATE_F);
+    _spatialSource.setSampleRate(sampleRate);
     _spatialSource.setSourcePosition(x, 5.0f);
     _spatialSource.recalculate();
     _postReleaseCounter = _spatialSource.getPostFxSamplesCount() + 2 * _delay + (int)TREMULANT_DELAY_LENGTH;
@@ -104,6 +107,25 @@ void Voice::reset()
 }
 
 void Voice::process(float* outL, float* outR)
+{
+    render();
+
+    // Spatial modellig is only applied on stereo voice output
+    if (outL != outR) {
+        _spatialSource.process(_buffer, outL, outR, SUB_FRAME_LENGTH);
+    } else {
+        memcpy(outL, _buffer, sizeof(float) * SUB_FRAME_LENGTH);
+    }
+}
+
+void Voice::processUnfiltered(float* outL, float* outR, int stride)
+{
+    render();
+
+    _spatialSource.processUnfiltered(_buffer, outL, outR, SUB_FRAME_LENGTH, stride);
+}
+
+void Voice::render()
 {
     memset(_buffer, 0, sizeof(float) * SUB_FRAME_LENGTH);
 
@@ -128,13 +150,6 @@ void Voice::process(float* outL, float* outR)
     }
 
     _chiff.process(_buffer, SUB_FRAME_LENGTH);
-
-    // Spatial modellig is only applied on stereo voice output
-    if (outL != outR) {
-        _spatialSource.process(_buffer, outL, outR, SUB_FRAME_LENGTH);
-    } else {
-        memcpy(outL, _buffer, sizeof(float) * SUB_FRAME_LENGTH);
-    }
 }
 
 bool Voice::isOver() const noexcept
@@ -47,6 +47,14 @@ public:
     void release();
     void reset();
     void process(float* outL, float* outR);
+
+    /**
+     * Render a stereo voice without the spatial filters, for them to be
+     * processed in a batch with the other voices.
+     * @param stride Distance between two output frames.
+     */
+    void processUnfiltered(float* outL, float* outR, int stride);
+    dsp::SpatialSource& getSpatialSource() noexcept { return _spatialSource; }
     bool isOver() const noexcept;
     bool isActive() const noexcept;
     bool isForNote(int note) const noexcept;
@@ -60,6 +68,10 @@ public:
     float getPanPosition() const noexcept { return _panPosition; }
 
 private:
+
+    /// Render the mono pipe sound and its chiff to the voice buffer.
+    void render();
+
     Engine& _engine;
     Pipewave::State _state; ///< Pipe state associated with this voice.
 
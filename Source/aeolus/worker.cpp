@@ -18,31 +18,127 @@
 // ----------------------------------------------------------------------------
 
 #include "aeolus/worker.h"
-#include "aeolus/ringbuffer.h"
 #include "aeolus/sema.h"
 
+#include <array>
 #include <atomic>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#   include <intrin.h>
+#endif
+
 using namespace juce;
 
 AEOLUS_NAMESPACE_BEGIN
 
+namespace {
+
+inline void cpuRelax() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/// Index of the lowest set bit, the mask must not be zero.
+inline int lowestBit(uint64_t mask) noexcept
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int) index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+template <typename T>
+void updateMax(std::atomic<T>& target, T value) noexcept
+{
+    T current = target.load(std::memory_order_relaxed);
+
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        // Retry
+    }
+}
+
+} // anonymous namespace
+
 struct Worker::Impl
 {
-    RingBuffer<Worker::Job*, DefaultCapacity> jobsQueue;
+    struct Slot
+    {
+        std::atomic<Job*> job{nullptr};
+        std::atomic<uint64_t> deadline{0};  ///< Absolute deadline on the sample clock.
+        std::atomic<int64> queuedTicks{0};  ///< Time the job was queued at.
+    };
 
-    Semaphore sema;
-    std::atomic_bool running;
-    std::unique_ptr<std::thread> thread;
+    constexpr static size_t NumOccupancyWords = DefaultCapacity / 64;
+    constexpr static int IdleSpinCount = 256;
+
+    static_assert(DefaultCapacity % 64 == 0, "Queue capacity must be a multiple of the occupancy word size");
+
+    /// Queued jobs. Whoever takes a job out of its slot owns it.
+    std::vector<Slot> slots;
+
+    /**
+     * Occupancy bit per slot. A bit is set after the job has been put to the slot,
+     * and cleared only after the job has been taken out of it, so the audio thread
+     * can reuse the slot as soon as its bit is clear.
+     */
+    std::array<std::atomic<uint64_t>, NumOccupancyWords> occupied;
+    size_t nextFreeWord;    ///< Free slot search hint (audio thread only).
 
-    Impl()
-        : jobsQueue()
+    LightweightSemaphore sema;
+    std::atomic_bool running;
+    int numThreads;
+    std::vector<std::thread> threads;
+
+    mutable std::mutex policyMutex;
+    ThreadPolicy policy;
+    String appliedPolicy;
+    std::atomic<int> policyGeneration;
+
+    std::atomic<uint64_t> clock;    ///< Sample clock.
+    std::atomic<int> pendingCount;
+
+    // Statistics
+    std::atomic<uint64_t> jobsCount;
+    std::atomic<int64> totalLatencyTicks;
+    std::atomic<int64> maxLatencyTicks;
+    std::atomic<uint64_t> missedDeadlines;
+    std::atomic<uint64_t> rejectedJobs;
+    std::atomic_bool resetRequested;    ///< Statistics reset to be applied by the next updater.
+
+    Impl(int nThreads)
+        : slots(DefaultCapacity)
+        , occupied{}
+        , nextFreeWord{0}
         , sema(0)
         , running(false)
-        , thread(nullptr)
+        , numThreads{nThreads > 0 ? nThreads : defaultNumThreads()}
+        , threads()
+        , policyMutex()
+        , policy{}
+        , appliedPolicy{"normal"}
+        , policyGeneration{0}
+        , clock{0}
+        , pendingCount{0}
+        , jobsCount{0}
+        , totalLatencyTicks{0}
+        , maxLatencyTicks{0}
+        , missedDeadlines{0}
+        , rejectedJobs{0}
+        , resetRequested{false}
     {
     }
 
@@ -53,52 +149,293 @@ struct Worker::Impl
 
     void run()
     {
+        int appliedGeneration = -1;
+
         while (running) {
-            Worker::Job* job = nullptr;
+            if (appliedGeneration != policyGeneration.load())
+                appliedGeneration = applyPolicy();
 
             wait();
 
-            if (running && jobsQueue.receive (job)) {
-                jassert(job != nullptr);
-                job->run();
+            if (running) {
+                if (Job* job = pickJob())
+                    execute(job);
+            }
+        }
+    }
+
+    /// Apply current policy to the calling thread.
+    int applyPolicy()
+    {
+        std::lock_guard<std::mutex> lock(policyMutex);
+
+        const int generation = policyGeneration.load();
+        appliedPolicy = policy.applyToCurrentThread();
+
+        return generation;
+    }
+
+    void setThreadPolicy(const ThreadPolicy& p)
+    {
+        {
+            std::lock_guard<std::mutex> lock(policyMutex);
+
+            if (policy == p)
+                return;
+
+            policy = p;
+            ++policyGeneration;
+        }
+
+        // Let the threads pick the new policy up.
+        for (size_t i = 0; i < threads.size(); ++i)
+            wakeUp();
+    }
+
+    void setNumThreads(int n)
+    {
+        n = n > 0 ? n : defaultNumThreads();
+
+        if (n == numThreads)
+            return;
+
+        const bool wasRunning = !threads.empty();
+
+        stop();
+        numThreads = n;
+
+        if (wasRunning)
+            start();
+    }
+
+    static int defaultNumThreads()
+    {
+        return jlimit(1, 4, SystemStats::getNumCpus() / 2);
+    }
+
+    /// Take the queued job with the earliest deadline.
+    Job* pickJob()
+    {
+        for (;;) {
+            Slot* best = nullptr;
+            Job* bestJob = nullptr;
+            uint64_t bestDeadline = 0;
+
+            // Only the occupied slots are looked at.
+            for (size_t w = 0; w < NumOccupancyWords; ++w) {
+                uint64_t mask = occupied[w].load(std::memory_order_acquire);
+
+                while (mask != 0) {
+                    auto& slot = slots[w * 64 + (size_t) lowestBit(mask)];
+                    mask &= mask - 1;
+
+                    Job* job = slot.job.load(std::memory_order_acquire);
+
+                    if (job != nullptr) {
+                        const auto deadline = slot.deadline.load(std::memory_order_relaxed);
+
+                        if (best == nullptr || deadline < bestDeadline) {
+                            best = &slot;
+                            bestJob = job;
+                            bestDeadline = deadline;
+                        }
+                    }
+                }
             }
+
+            if (best == nullptr)
+                return nullptr;
+
+            if (take(*best, bestJob))
+                return bestJob;
+
+            // Taken by another thread, try again.
         }
     }
 
-    bool addJob (Job* job)
+    /// Take the job out of the queue. This transfers the job ownership to the caller.
+    bool take(Slot& slot, Job* job) noexcept
+    {
+        if (!slot.job.compare_exchange_strong(job, nullptr, std::memory_order_acq_rel))
+            return false;
+
+        release(job->slot);
+        updateStats(Time::getHighResolutionTicks() - slot.queuedTicks.load(std::memory_order_relaxed));
+        job->state.store(Job::Running, std::memory_order_relaxed);
+        --pendingCount;
+
+        return true;
+    }
+
+    /// Mark the slot free, once its job has been taken out.
+    void release(size_t index) noexcept
+    {
+        occupied[index / 64].fetch_and(~(uint64_t(1) << (index % 64)), std::memory_order_release);
+    }
+
+    void execute(Job* job)
+    {
+        job->run();
+        job->state.store(Job::Idle, std::memory_order_release);
+
+        // Pairs with the fence in waitIdle(): either the waiter sees
+        // the job idle, or we see the waiter and wake it up.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (LightweightSemaphore* waiter = job->waiter.exchange(nullptr, std::memory_order_acq_rel))
+            waiter->notify();
+    }
+
+    bool addJob(Job* job, int deadline)
     {
         jassert(job != nullptr);
+        jassert(!job->isPending());
+
+        for (size_t k = 0; k < NumOccupancyWords; ++k) {
+            const size_t w = (nextFreeWord + k) % NumOccupancyWords;
+            const uint64_t mask = occupied[w].load(std::memory_order_acquire);
+
+            if (mask != ~uint64_t(0)) {
+                const int bit = lowestBit(~mask);
+                const size_t index = w * 64 + (size_t) bit;
+                auto& slot = slots[index];
+                const auto now = clock.load(std::memory_order_relaxed);
+
+                slot.deadline.store(deadline == NoDeadline ? std::numeric_limits<uint64_t>::max() : now + (uint64_t) jmax(0, deadline),
+                                    std::memory_order_relaxed);
+                slot.queuedTicks.store(Time::getHighResolutionTicks(), std::memory_order_relaxed);
 
-        const auto ok = jobsQueue.send (job);
-        wakeUp();
+                job->slot = index;
+                job->state.store(Job::Queued, std::memory_order_relaxed);
+                ++pendingCount;
 
-        return ok;
+                slot.job.store(job, std::memory_order_release);
+                occupied[w].fetch_or(uint64_t(1) << bit, std::memory_order_release);
+                nextFreeWord = w;
+
+                wakeUp();
+                return true;
+            }
+        }
+
+        applyStatsReset();
+        ++rejectedJobs;
+        return false;
+    }
+
+    bool complete(Job* job) noexcept
+    {
+        jassert(job != nullptr);
+
+        if (!job->isPending())
+            return false;
+
+        applyStatsReset();
+        ++missedDeadlines;
+
+        if (take(slots[job->slot], job)) {
+            // Nobody has picked the job up in time - run it here.
+            execute(job);
+        } else {
+            waitIdle(job);
+        }
+
+        return true;
+    }
+
+    void cancel(Job* job) noexcept
+    {
+        jassert(job != nullptr);
+
+        if (!job->isPending())
+            return;
+
+        Job* expected = job;
+
+        if (slots[job->slot].job.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+            release(job->slot);
+            --pendingCount;
+            job->state.store(Job::Idle, std::memory_order_release);
+        } else {
+            waitIdle(job);
+        }
+    }
+
+    /**
+     * Wait for a running job to finish. A job that is about to finish
+     * is caught by a short spin, otherwise the calling thread registers
+     * its own semaphore with the job, and the worker thread that runs
+     * the job signals it. Each waiter is woken by its own job only,
+     * so concurrent waiters on different jobs cannot steal each other's
+     * wake-ups.
+     */
+    void waitIdle(Job* job) noexcept
+    {
+        for (int i = 0; i < IdleSpinCount; ++i) {
+            if (!job->isPending())
+                return;
+
+            cpuRelax();
+        }
+
+        thread_local LightweightSemaphore waiterSema(0, 0);
+
+        LightweightSemaphore* expected = nullptr;
+        const bool registered = job->waiter.compare_exchange_strong(expected, &waiterSema, std::memory_order_acq_rel);
+        jassert(registered); // Only one thread may wait for a job.
+
+        if (!registered) {
+            while (job->isPending())
+                std::this_thread::yield();
+
+            return;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (job->isPending()) {
+            // The worker thread will see the waiter and signal it exactly once.
+            waiterSema.wait();
+        } else if (job->waiter.exchange(nullptr, std::memory_order_acq_rel) == nullptr) {
+            // The worker thread has already taken the waiter, consume its signal.
+            waiterSema.wait();
+        }
+
+        jassert(!job->isPending());
     }
 
     void start()
     {
         purge();
 
-        if (thread == nullptr) {
+        if (threads.empty()) {
             running = true;
-            thread = std::make_unique<std::thread> (&Impl::run, this);
+
+            for (int i = 0; i < numThreads; ++i)
+                threads.emplace_back(&Impl::run, this);
         }
     }
 
     void stop()
     {
-        if (thread != nullptr) {
+        if (!threads.empty()) {
             running = false;
-            wakeUp();
 
-            if (thread->joinable())
-                thread->join();
+            for (size_t i = 0; i < threads.size(); ++i)
+                wakeUp();
+
+            for (auto& thread : threads) {
+                if (thread.joinable())
+                    thread.join();
+            }
+
+            threads.clear();
         }
     }
 
     bool hasPendingJobs() noexcept
     {
-        return jobsQueue.count() > 0;
+        return pendingCount.load(std::memory_order_relaxed) > 0;
     }
 
     bool isRunning() const noexcept
@@ -108,10 +445,9 @@ struct Worker::Impl
 
     void purge()
     {
-        Worker::Job* job;
-
-        while (jobsQueue.receive (job)) {
-            // Do nothing.
+        for (auto& slot : slots) {
+            if (Job* job = slot.job.load(std::memory_order_acquire))
+                cancel(job);
         }
     }
 
@@ -124,12 +460,62 @@ struct Worker::Impl
     {
         sema.notify();
     }
+
+    void updateStats(int64 latencyTicks)
+    {
+        applyStatsReset();
+
+        jobsCount.fetch_add(1, std::memory_order_relaxed);
+        totalLatencyTicks.fetch_add(latencyTicks, std::memory_order_relaxed);
+        updateMax(maxLatencyTicks, latencyTicks);
+    }
+
+    Stats getStats() const noexcept
+    {
+        const double ticksToMs = 1000.0 / (double) Time::getHighResolutionTicksPerSecond();
+        Stats stats;
+
+        if (resetRequested.load(std::memory_order_acquire))
+            return stats;
+
+        const auto n = jobsCount.load(std::memory_order_relaxed);
+
+        stats.jobsCount = n;
+        stats.averageLatencyMs = n > 0 ? ticksToMs * (double) totalLatencyTicks.load(std::memory_order_relaxed) / (double) n : 0.0;
+        stats.maxLatencyMs = ticksToMs * (double) maxLatencyTicks.load(std::memory_order_relaxed);
+        stats.missedDeadlines = missedDeadlines.load(std::memory_order_relaxed);
+        stats.rejectedJobs = rejectedJobs.load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    /**
+     * Statistics are updated by the worker and the audio threads concurrently,
+     * so instead of clearing the counters under their feet the reset is only
+     * requested here, and the first thread to update the statistics afterwards
+     * clears them before adding its own sample.
+     */
+    void resetStats() noexcept
+    {
+        resetRequested.store(true, std::memory_order_release);
+    }
+
+    void applyStatsReset() noexcept
+    {
+        if (resetRequested.load(std::memory_order_relaxed) && resetRequested.exchange(false, std::memory_order_acq_rel)) {
+            jobsCount.store(0, std::memory_order_relaxed);
+            totalLatencyTicks.store(0, std::memory_order_relaxed);
+            maxLatencyTicks.store(0, std::memory_order_relaxed);
+            missedDeadlines.store(0, std::memory_order_relaxed);
+            rejectedJobs.store(0, std::memory_order_relaxed);
+        }
+    }
 };
 
 //----------------------------------------------------------
 
-Worker::Worker()
-    : d(std::make_unique<Impl>())
+Worker::Worker(int numThreads)
+    : d(std::make_unique<Impl>(numThreads))
 {
 }
 
@@ -145,9 +531,51 @@ void Worker::stop()
     d->stop();
 }
 
-bool Worker::addJob(Job* job)
+int Worker::getNumThreads() const noexcept
+{
+    return d->numThreads;
+}
+
+void Worker::setNumThreads(int numThreads)
+{
+    d->setNumThreads(numThreads);
+}
+
+void Worker::setThreadPolicy(const ThreadPolicy& policy)
 {
-    return d->addJob (job);
+    d->setThreadPolicy(policy);
+}
+
+ThreadPolicy Worker::getThreadPolicy() const
+{
+    std::lock_guard<std::mutex> lock(d->policyMutex);
+    return d->policy;
+}
+
+String Worker::getAppliedThreadPolicy() const
+{
+    std::lock_guard<std::mutex> lock(d->policyMutex);
+    return d->appliedPolicy;
+}
+
+bool Worker::addJob(Job* job, int deadline)
+{
+    return d->addJob (job, deadline);
+}
+
+void Worker::advance(int numSamples) noexcept
+{
+    d->clock.store(d->clock.load(std::memory_order_relaxed) + (uint64_t) numSamples, std::memory_order_relaxed);
+}
+
+bool Worker::complete(Job* job) noexcept
+{
+    return d->complete(job);
+}
+
+void Worker::cancel(Job* job) noexcept
+{
+    d->cancel(job);
 }
 
 bool Worker::hasPendingJobs() noexcept
@@ -165,4 +593,14 @@ void Worker::purge()
     d->purge();
 }
 
+Worker::Stats Worker::getStats() const noexcept
+{
+    return d->getStats();
+}
+
+void Worker::resetStats() noexcept
+{
+    d->resetStats();
+}
+
 AEOLUS_NAMESPACE_END
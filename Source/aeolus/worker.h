@@ -20,18 +20,29 @@
 #pragma once
 
 #include "aeolus/globals.h"
+#include "aeolus/threading.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <functional>
+#include <limits>
 
 AEOLUS_NAMESPACE_BEGIN
 
+class LightweightSemaphore;
+
 /**
- * @brief Schedule jobs run on a separate thread.
+ * @brief Schedule jobs run on a pool of side threads.
+ *
+ * Jobs are scheduled on audio thread, and executed on side threads
+ * in earliest-deadline-first order. A deadline is expressed as a number
+ * of samples until the job's result is needed, counted against the
+ * worker's sample clock, which the audio thread moves forward via advance().
  *
- * This class uses a lock-free queue to schedulre jobs
- * on audio thread, and execute them on a side thead.
- * This is normally used for samples streaming.
+ * When the audio thread needs the result it calls complete(): a job
+ * that has not been started yet is run in place, a running one is waited for.
+ * Either case is counted as a missed deadline.
  */
 class Worker final
 {
@@ -40,16 +51,55 @@ public:
     class Job
     {
     public:
-        virtual void run() = 0;
+        Job() = default;
         virtual ~Job() = default;
+
+        virtual void run() = 0;
+
+        /// Tells whether the job is queued or running.
+        bool isPending() const noexcept { return state.load (std::memory_order_acquire) != Idle; }
+
+    private:
+        friend class Worker;
+
+        enum State
+        {
+            Idle,
+            Queued,
+            Running
+        };
+
+        std::atomic<int> state{Idle};
+        size_t slot{0};     ///< Queue slot the job has been put to.
+        std::atomic<LightweightSemaphore*> waiter{nullptr};  ///< Thread waiting for the job to finish.
     };
 
-    //------------------------------------------------------
+    /**
+     * @brief Job scheduling statistics.
+     *
+     * Latency is measured from the moment a job is added
+     * till a worker thread starts running it.
+     */
+    struct Stats
+    {
+        uint64_t jobsCount{0};
+        double averageLatencyMs{0.0};
+        double maxLatencyMs{0.0};
+        uint64_t missedDeadlines{0};    ///< Jobs the audio thread had to run or wait for.
+        uint64_t rejectedJobs{0};       ///< Jobs that did not fit into the queue.
+    };
 
     /// Maximum allowed number of queued jobs
     constexpr static size_t DefaultCapacity = 1024;
 
-    Worker();
+    /// Deadline for jobs that are not urgent.
+    constexpr static int NoDeadline = std::numeric_limits<int>::max();
+
+    /**
+     * @param numThreads Number of threads in the pool, or 0 to pick
+     *                   it based on the number of CPUs available.
+     */
+    explicit Worker(int numThreads = 0);
     ~Worker();
     Worker(const Worker&) = delete;
     Worker& operator = (const Worker&) = delete;
@@ -57,17 +107,66 @@ public:
     void start();
     void stop();
 
+    int getNumThreads() const noexcept;
+
+    /**
+     * @brief Change the number of threads in the pool.
+     * @note This restarts the pool if it is running.
+     */
+    void setNumThreads(int numThreads);
+
+    /**
+     * @brief Change the scheduling policy of the pool threads.
+     *
+     * Running threads pick up the new policy when woken up.
+     */
+    void setThreadPolicy(const ThreadPolicy& policy);
+    ThreadPolicy getThreadPolicy() const;
+
+    /// Policy actually applied to the pool threads (may differ from the requested one).
+    juce::String getAppliedThreadPolicy() const;
+
     /**
      * @brief Add job to the queue.
      *
+     * @param deadline Number of samples until the job's result is needed.
+     * @return false if the queue is full.
+     *
      * @note This must be called from audio thread only.
      */
-    bool addJob(Job* job);
+    bool addJob(Job* job, int deadline = NoDeadline);
+
+    /**
+     * @brief Move the sample clock forward.
+     * @note This must be called from audio thread only.
+     */
+    void advance(int numSamples) noexcept;
+
+    /**
+     * @brief Make sure the job has been completed.
+     *
+     * A job that is still in the queue is run on the calling
+     * thread, and a running one is waited for.
+     *
+     * @return true if the job has missed its deadline.
+     */
+    bool complete(Job* job) noexcept;
+
+    /**
+     * @brief Remove the job from the queue.
+     *
+     * If the job is already running this will wait for it to finish.
+     */
+    void cancel(Job* job) noexcept;
+
     bool hasPendingJobs() noexcept;
     bool isRunning() const noexcept;
 
     void purge();
 
+    Stats getStats() const noexcept;
+    void resetStats() noexcept;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> d;
@@ -29,6 +29,25 @@ SettingsComponent::SettingsComponent()
     : _settingsLabel {{}, "Global settings"}
     , _uiScalingFactorLabel {{}, "UI scaling factor"}
     , _uiScalingFactorSlider{Slider::IncDecButtons, Slider::TextBoxLeft}
+    , _realtimeSchedulingLabel {{}, "Reverb threads"}
+    , _realtimeSchedulingComboBox{}
+    , _realtimePriorityLabel {{}, "Reverb priority"}
+    , _realtimePrioritySlider{Slider::IncDecButtons, Slider::TextBoxLeft}
+    , _realtimeAffinityLabel {{}, "Reverb CPUs"}
+    , _realtimeAffinityEditor{}
+    , _bulkAffinityLabel {{}, "Wavetables CPUs"}
+    , _bulkAffinityEditor{}
+    , _threadingReportLabel{}
+    , _nativeSampleRateButton{"Native sample rate"}
+    , _resamplingQualityLabel {{}, "Resampling"}
+    , _resamplingQualityComboBox{}
+    , _renderAheadLabel {{}, "Render ahead"}
+    , _renderAheadComboBox{}
+    , _limiterLookaheadLabel {{}, "Limiter lookahead"}
+    , _limiterLookaheadComboBox{}
+    , _reverbTailLabel {{}, "Reverb tail"}
+    , _reverbTailComboBox{}
+    , _renderingReportLabel{}
     , _defaultButton{"Default"}
     , _okButton{"OK"}
     , _cancelButton{"Cancel"}
@@ -49,10 +68,102 @@ SettingsComponent::SettingsComponent()
     _uiScalingFactorSlider.setRange(aeolus::UI_SCALING_MIN, aeolus::UI_SCALING_MAX, aeolus::UI_SCALING_SETP);
     _uiScalingFactorSlider.setValue(g->getUIScalingFactor(), juce::dontSendNotification);
 
+    addAndMakeVisible(_realtimeSchedulingLabel);
+    addAndMakeVisible(_realtimeSchedulingComboBox);
+
+    for (int i = 0; i < (int)aeolus::ThreadPolicy::NumSchedulings; ++i)
+        _realtimeSchedulingComboBox.addItem(aeolus::ThreadPolicy::getSchedulingName(static_cast<aeolus::ThreadPolicy::Scheduling>(i)), i + 1);
+
+    _realtimeSchedulingComboBox.onChange = [this] { updateThreadingControls(); };
+
+    addAndMakeVisible(_realtimePriorityLabel);
+    addAndMakeVisible(_realtimePrioritySlider);
+    _realtimePrioritySlider.setTextBoxStyle(Slider::TextBoxLeft, false, 70, 20);
+    _realtimePrioritySlider.setRange(aeolus::ThreadPolicy::MinPriority, aeolus::ThreadPolicy::MaxPriority, 1);
+
+    addAndMakeVisible(_realtimeAffinityLabel);
+    addAndMakeVisible(_realtimeAffinityEditor);
+    _realtimeAffinityEditor.setInputRestrictions(64, "0123456789,- ");
+    _realtimeAffinityEditor.setTextToShowWhenEmpty("any", Colours::grey);
+
+    addAndMakeVisible(_bulkAffinityLabel);
+    addAndMakeVisible(_bulkAffinityEditor);
+    _bulkAffinityEditor.setInputRestrictions(64, "0123456789,- ");
+    _bulkAffinityEditor.setTextToShowWhenEmpty("any", Colours::grey);
+
+    const auto& realtimePolicy = g->getRealtimeThreadPolicy();
+    _realtimeSchedulingComboBox.setSelectedId((int)realtimePolicy.scheduling + 1, juce::dontSendNotification);
+    _realtimePrioritySlider.setValue(realtimePolicy.priority, juce::dontSendNotification);
+    _realtimeAffinityEditor.setText(realtimePolicy.affinity, false);
+    _bulkAffinityEditor.setText(g->getBulkThreadPolicy().affinity, false);
+
+    addAndMakeVisible(_threadingReportLabel);
+    _threadingReportLabel.setFont(Font(FontOptions(Font::getDefaultMonospacedFontName(), 10, Font::plain)));
+    _threadingReportLabel.setJustificationType(Justification::topLeft);
+    _threadingReportLabel.setColour(Label::textColourId, Colours::lightgrey);
+
+    addAndMakeVisible(_nativeSampleRateButton);
+    _nativeSampleRateButton.setColour(ToggleButton::textColourId, Colour(0xFF, 0xFF, 0xFF));
+    _nativeSampleRateButton.setToggleState(g->isNativeSampleRate(), dontSendNotification);
+
+    addAndMakeVisible(_resamplingQualityLabel);
+    addAndMakeVisible(_resamplingQualityComboBox);
+
+    for (int i = 0; i < (int)aeolus::dsp::Resampler::NumQualities; ++i)
+        _resamplingQualityComboBox.addItem(aeolus::dsp::Resampler::getQualityName(static_cast<aeolus::dsp::Resampler::Quality>(i)), i + 1);
+
+    _resamplingQualityComboBox.setSelectedId((int)g->getResamplingQuality() + 1, juce::dontSendNotification);
+
+    // Item ids are the number of sub-frames plus one.
+    addAndMakeVisible(_renderAheadLabel);
+    addAndMakeVisible(_renderAheadComboBox);
+    _renderAheadComboBox.addItem("Off", 1);
+    _renderAheadComboBox.addItem("1 sub-frame", 2);
+    _renderAheadComboBox.addItem("2 sub-frames", 3);
+    _renderAheadComboBox.addItem("4 sub-frames", 5);
+    _renderAheadComboBox.addItem("8 sub-frames", 9);
+    _renderAheadComboBox.setSelectedId(g->getRenderAheadSubFrames() + 1, juce::dontSendNotification);
+
+    // Item ids are the lookahead in ms.
+    addAndMakeVisible(_limiterLookaheadLabel);
+    addAndMakeVisible(_limiterLookaheadComboBox);
+    _limiterLookaheadComboBox.addItem("1 ms", 1);
+    _limiterLookaheadComboBox.addItem("2 ms", 2);
+    _limiterLookaheadComboBox.addItem("5 ms", 5);
+    _limiterLookaheadComboBox.addItem("10 ms", 10);
+    _limiterLookaheadComboBox.setSelectedId(g->getLimiterLookahead(), juce::dontSendNotification);
+
+    // Item ids are the tail decimation factor.
+    addAndMakeVisible(_reverbTailLabel);
+    addAndMakeVisible(_reverbTailComboBox);
+    _reverbTailComboBox.addItem("Full rate", 1);
+    _reverbTailComboBox.addItem("1/2 rate", 2);
+    _reverbTailComboBox.addItem("1/4 rate", 4);
+    _reverbTailComboBox.setSelectedId(g->getReverbTailDecimation(), juce::dontSendNotification);
+
+    addAndMakeVisible(_renderingReportLabel);
+    _renderingReportLabel.setFont(Font(FontOptions(Font::getDefaultMonospacedFontName(), 10, Font::plain)));
+    _renderingReportLabel.setJustificationType(Justification::topLeft);
+    _renderingReportLabel.setColour(Label::textColourId, Colours::lightgrey);
+
+    updateThreadingControls();
+    timerCallback();
+    startTimer(500);
 
     addAndMakeVisible(_defaultButton);
     _defaultButton.onClick = [this] {
         _uiScalingFactorSlider.setValue(aeolus::UI_SCALING_DEFAULT);
+
+        const aeolus::ThreadPolicy defaultPolicy{};
+        _realtimeSchedulingComboBox.setSelectedId((int)defaultPolicy.scheduling + 1);
+        _realtimePrioritySlider.setValue(defaultPolicy.priority);
+        _realtimeAffinityEditor.clear();
+        _bulkAffinityEditor.clear();
+        _nativeSampleRateButton.setToggleState(false, dontSendNotification);
+        _resamplingQualityComboBox.setSelectedId((int)aeolus::dsp::Resampler::Medium + 1);
+        _renderAheadComboBox.setSelectedId(1);
+        _limiterLookaheadComboBox.setSelectedId(aeolus::EngineGlobal::DefaultLimiterLookahead);
+        _reverbTailComboBox.setSelectedId(1);
     };
 
     addAndMakeVisible(_okButton);
@@ -75,6 +186,62 @@ float SettingsComponent::getUIScalingFactor() const
     return (float)_uiScalingFactorSlider.getValue();
 }
 
+aeolus::ThreadPolicy SettingsComponent::getRealtimeThreadPolicy() const
+{
+    aeolus::ThreadPolicy policy{};
+    policy.scheduling = static_cast<aeolus::ThreadPolicy::Scheduling>(jmax(0, _realtimeSchedulingComboBox.getSelectedId() - 1));
+    policy.priority = (int)_realtimePrioritySlider.getValue();
+    policy.affinity = _realtimeAffinityEditor.getText().trim();
+
+    return policy;
+}
+
+aeolus::ThreadPolicy SettingsComponent::getBulkThreadPolicy() const
+{
+    aeolus::ThreadPolicy policy{};
+    policy.affinity = _bulkAffinityEditor.getText().trim();
+
+    return policy;
+}
+
+bool SettingsComponent::getNativeSampleRate() const
+{
+    return _nativeSampleRateButton.getToggleState();
+}
+
+aeolus::dsp::Resampler::Quality SettingsComponent::getResamplingQuality() const
+{
+    return static_cast<aeolus::dsp::Resampler::Quality>(jmax(0, _resamplingQualityComboBox.getSelectedId() - 1));
+}
+
+int SettingsComponent::getRenderAheadSubFrames() const
+{
+    return jmax(0, _renderAheadComboBox.getSelectedId() - 1);
+}
+
+int SettingsComponent::getLimiterLookahead() const
+{
+    const int ms = _limiterLookaheadComboBox.getSelectedId();
+    return ms > 0 ? ms : aeolus::EngineGlobal::DefaultLimiterLookahead;
+}
+
+int SettingsComponent::getReverbTailDecimation() const
+{
+    return jmax(1, _reverbTailComboBox.getSelectedId());
+}
+
+void SettingsComponent::updateThreadingControls()
+{
+    _realtimePrioritySlider.setEnabled(_realtimeSchedulingComboBox.getSelectedId() - 1 != (int)aeolus::ThreadPolicy::Normal);
+}
+
+void SettingsComponent::timerCallback()
+{
+    auto* g = aeolus::EngineGlobal::getInstance();
+    _threadingReportLabel.setText(g->getThreadingReport(), juce::dontSendNotification);
+    _renderingReportLabel.setText(g->getRenderingReport(), juce::dontSendNotification);
+}
+
 void SettingsComponent::resized()
 {
     constexpr int margin = 6;
@@ -90,6 +257,54 @@ void SettingsComponent::resized()
     _uiScalingFactorLabel.setBounds(row.removeFromLeft(120));
     _uiScalingFactorSlider.setBounds(row.removeFromLeft(110));
 
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _realtimeSchedulingLabel.setBounds(row.removeFromLeft(120));
+    _realtimeSchedulingComboBox.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _realtimePriorityLabel.setBounds(row.removeFromLeft(120));
+    _realtimePrioritySlider.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _realtimeAffinityLabel.setBounds(row.removeFromLeft(120));
+    _realtimeAffinityEditor.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _bulkAffinityLabel.setBounds(row.removeFromLeft(120));
+    _bulkAffinityEditor.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    _threadingReportLabel.setBounds(bounds.removeFromTop(58));
+
+    bounds.removeFromTop(margin);
+    _nativeSampleRateButton.setBounds(bounds.removeFromTop(20));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _resamplingQualityLabel.setBounds(row.removeFromLeft(120));
+    _resamplingQualityComboBox.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _renderAheadLabel.setBounds(row.removeFromLeft(120));
+    _renderAheadComboBox.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _limiterLookaheadLabel.setBounds(row.removeFromLeft(120));
+    _limiterLookaheadComboBox.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    row = bounds.removeFromTop(20);
+    _reverbTailLabel.setBounds(row.removeFromLeft(120));
+    _reverbTailComboBox.setBounds(row.removeFromLeft(110));
+
+    bounds.removeFromTop(margin);
+    _renderingReportLabel.setBounds(bounds.removeFromTop(70));
 
     row = bounds.removeFromBottom(20);
     _defaultButton.setBounds(row.removeFromLeft(60));
@@ -21,18 +21,28 @@
 
 #include <functional>
 #include "aeolus/globals.h"
+#include "aeolus/threading.h"
+#include "aeolus/dsp/resampler.h"
 
 namespace ui {
 
 /**
  * Setting component (shown in a callout box when clicking the setting button).
  */
-class SettingsComponent : public juce::Component
+class SettingsComponent : public juce::Component,
+                          private juce::Timer
 {
 public:
     SettingsComponent();
 
     float getUIScalingFactor() const;
+    aeolus::ThreadPolicy getRealtimeThreadPolicy() const;
+    aeolus::ThreadPolicy getBulkThreadPolicy() const;
+    bool getNativeSampleRate() const;
+    aeolus::dsp::Resampler::Quality getResamplingQuality() const;
+    int getRenderAheadSubFrames() const;
+    int getLimiterLookahead() const;
+    int getReverbTailDecimation() const;
 
     void resized() override;
 
@@ -41,10 +51,36 @@ public:
 
 private:
 
+    void updateThreadingControls();
+
+    // juce::Timer
+    void timerCallback() override;
+
     juce::Label _settingsLabel;
     juce::Label _uiScalingFactorLabel;
     juce::Slider _uiScalingFactorSlider;
 
+    juce::Label _realtimeSchedulingLabel;
+    juce::ComboBox _realtimeSchedulingComboBox;
+    juce::Label _realtimePriorityLabel;
+    juce::Slider _realtimePrioritySlider;
+    juce::Label _realtimeAffinityLabel;
+    juce::TextEditor _realtimeAffinityEditor;
+    juce::Label _bulkAffinityLabel;
+    juce::TextEditor _bulkAffinityEditor;
+    juce::Label _threadingReportLabel;
+
+    juce::ToggleButton _nativeSampleRateButton;
+    juce::Label _resamplingQualityLabel;
+    juce::ComboBox _resamplingQualityComboBox;
+    juce::Label _renderAheadLabel;
+    juce::ComboBox _renderAheadComboBox;
+    juce::Label _limiterLookaheadLabel;
+    juce::ComboBox _limiterLookaheadComboBox;
+    juce::Label _reverbTailLabel;
+    juce::ComboBox _reverbTailComboBox;
+    juce::Label _renderingReportLabel;
+
     juce::TextButton _defaultButton;
     juce::TextButton _okButton;
     juce::TextButton _cancelButton;